@@ -0,0 +1,78 @@
+/* bench_compiled.cpp
+ *
+ * Compares loading a large generated ini file as text with loading the
+ * compiled snapshot built from it, and with opening the snapshot in place.
+ */
+
+#include <inicpp.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static std::string MakeContent(const int sections, const int fields) {
+  std::string content;
+  for (int sec = 0; sec < sections; ++sec) {
+    content += "[host-" + std::to_string(sec) + ".fleet.example.com]\n";
+    for (int field = 0; field < fields; ++field)
+      content += "attribute_" + std::to_string(field) + " = value " + std::to_string(sec * 31 + field) + "\n";
+  }
+  return content;
+}
+
+template <typename Fn>
+static double BestOf(const int repetitions, Fn fn) {
+  double best = 0;
+  for (int rep = 0; rep < repetitions; ++rep) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (rep == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+int main() {
+  const char* text_file = "bench_compiled.ini";
+  const char* snapshot_file = "bench_compiled.ini.bin";
+  {
+    const std::string content = MakeContent(20000, 40);
+    std::ofstream os(text_file, std::ios::binary | std::ios::trunc);
+    os << content;
+    std::cout << "input size: " << content.size() / (1 << 20) << " MiB" << std::endl;
+  }
+  {
+    ini::IniFile inif;
+    inif.Load(text_file);
+    if (!inif.SaveCompiled(snapshot_file, text_file)) {
+      std::cerr << "could not write the snapshot" << std::endl;
+      return 1;
+    }
+  }
+
+  const double text = BestOf(5, [&]() {
+    ini::IniFile inif;
+    inif.Load(text_file);
+  });
+  std::cout << "Load: " << text << " ms" << std::endl;
+
+  const double compiled = BestOf(5, [&]() {
+    ini::IniFile inif;
+    inif.LoadCompiled(snapshot_file, text_file);
+  });
+  std::cout << "LoadCompiled: " << compiled << " ms (speedup " << text / compiled << "x)" << std::endl;
+
+  const double verify = BestOf(5, [&]() {
+    ini::CompiledIni snapshot;
+    if (!snapshot.Open(snapshot_file) || !snapshot.Verify())
+      std::cerr << "snapshot is corrupt" << std::endl;
+  });
+  std::cout << "Open and Verify: " << verify << " ms" << std::endl;
+
+  std::remove(text_file);
+  std::remove(snapshot_file);
+  return 0;
+}
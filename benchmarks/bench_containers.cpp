@@ -0,0 +1,82 @@
+/* bench_containers.cpp
+ *
+ * Compares field lookups and full iteration of the container policies on
+ * a file with sections of typical size.
+ */
+
+#include <inicpp.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static std::string MakeContent(const int sections, const int fields) {
+  std::string content;
+  for (int sec = 0; sec < sections; ++sec) {
+    content += "[service_" + std::to_string(sec) + "]\n";
+    for (int field = 0; field < fields; ++field)
+      content += "option_" + std::to_string(field) + " = " + std::to_string(sec * 31 + field) + "\n";
+  }
+  return content;
+}
+
+template <typename Fn>
+static double BestOf(const int repetitions, Fn fn) {
+  double best = 0;
+  for (int rep = 0; rep < repetitions; ++rep) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (rep == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+template <typename File>
+static void Run(const char* name, const std::string& content, const int sections, const int fields) {
+  File inif;
+  const double decode = BestOf(3, [&]() { inif.Decode(content); });
+
+  std::vector<std::string> section_names;
+  std::vector<std::string> field_names;
+  for (int sec = 0; sec < sections; ++sec)
+    section_names.push_back("service_" + std::to_string((sec * 7919) % sections));
+  for (int field = 0; field < fields; ++field)
+    field_names.push_back("option_" + std::to_string((field * 104729) % fields));
+
+  std::size_t checksum = 0;
+  const double lookup = BestOf(3, [&]() {
+    for (const std::string& section_name : section_names) {
+      const auto& section = inif.at(section_name);
+      for (const std::string& field_name : field_names)
+        checksum += section.find(field_name)->first.size();
+    }
+  });
+  const double iterate = BestOf(3, [&]() {
+    for (const auto& section : inif)
+      for (const auto& field : section.second)
+        checksum += field.first.size();
+  });
+
+  std::cout << name << ": decode " << decode << " ms, lookup " << lookup << " ms, iterate " << iterate << " ms"
+            << (checksum == 0 ? " (empty)" : "") << std::endl;
+}
+
+int main() {
+  const int sections = 2000;
+  const int fields = 100;
+  const std::string content = MakeContent(sections, fields);
+  std::cout << sections << " sections with " << fields << " fields" << std::endl;
+
+  Run<ini::IniFileBase<std::less<std::string>, ini::MapContainer>>("map  ", content, sections, fields);
+  Run<ini::IniFileBase<std::less<std::string>, ini::ArenaMapContainer>>("arena", content, sections, fields);
+  Run<ini::IniFileBase<std::less<std::string>, ini::FlatMapContainer>>("flat ", content, sections, fields);
+  Run<ini::IniFileBase<std::less<std::string>, ini::HashMapContainer>>("hash ", content, sections, fields);
+  Run<ini::IniFileBase<ini::StringInsensitiveLess, ini::MapContainer>>("map   (case insensitive)", content, sections,
+                                                                      fields);
+  Run<ini::IniFileBase<ini::StringInsensitiveLess, ini::HashMapContainer>>("hash  (case insensitive)", content,
+                                                                          sections, fields);
+  return 0;
+}
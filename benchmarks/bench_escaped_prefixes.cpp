@@ -0,0 +1,44 @@
+/* bench_escaped_prefixes.cpp
+ *
+ * Times decoding values that contain many escaped comment prefixes, which
+ * the comment stripper has to unescape in a single pass.
+ */
+
+#include <inicpp.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+static std::string MakeContent(const std::size_t prefixes) {
+  std::string content = "[Sec]\nkey=";
+  for (std::size_t i = 0; i < prefixes; ++i)
+    content += (i % 2 == 0) ? "\\#" : "\\;";
+  content += " # trailing comment\n";
+  return content;
+}
+
+template <typename Fn>
+static double BestOf(const int repetitions, Fn fn) {
+  double best = 0;
+  for (int rep = 0; rep < repetitions; ++rep) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (rep == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+int main() {
+  for (const std::size_t prefixes : {10000u, 100000u, 1000000u}) {
+    const std::string content = MakeContent(prefixes);
+    const double elapsed = BestOf(5, [&]() {
+      ini::IniFile inif;
+      inif.Decode(content);
+    });
+    std::cout << prefixes << " escaped prefixes: " << elapsed << " ms" << std::endl;
+  }
+  return 0;
+}
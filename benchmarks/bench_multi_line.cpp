@@ -0,0 +1,44 @@
+/* bench_multi_line.cpp
+ *
+ * Measures decoding of long multi-line values, e.g. embedded certificate
+ * bundles or SQL statements.
+ */
+
+#include <inicpp.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+static std::string MakeContent(const int lines) {
+  std::string content = "[Bundle]\npem = -----BEGIN CERTIFICATE-----\n";
+  for (int i = 0; i < lines; ++i)
+    content += "    MIIDdzCCAl+gAwIBAgIEAgAAuTANBgkqhkiG9w0BAQUFADBaMQswCQYDVQQGEwJJ\n";
+  content += "    -----END CERTIFICATE-----\n";
+  return content;
+}
+
+int main() {
+  const int kRepetitions = 5;
+  const int kLineCounts[] = {1000, 10000, 100000};
+
+  for (const int lines : kLineCounts) {
+    const std::string content = MakeContent(lines);
+    double best = 0;
+    std::size_t value_size = 0;
+    for (int rep = 0; rep < kRepetitions; ++rep) {
+      ini::IniFile inif;
+      inif.SetMultiLineValues(true);
+      const auto start = std::chrono::steady_clock::now();
+      inif.Decode(content);
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      value_size = inif["Bundle"]["pem"].As<std::string>().size();
+      if (rep == 0 || elapsed.count() < best)
+        best = elapsed.count();
+    }
+    std::cout << lines << " continuation lines: " << best << " ms (value size " << value_size << " bytes)"
+              << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+/* bench_parallel_decode.cpp
+ *
+ * Compares sequential and parallel decoding of a large generated ini file.
+ */
+
+#include <inicpp.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static std::string MakeContent(const int sections, const int fields) {
+  std::string content;
+  for (int sec = 0; sec < sections; ++sec) {
+    content += "[host-" + std::to_string(sec) + ".fleet.example.com]\n";
+    for (int field = 0; field < fields; ++field)
+      content += "attribute_" + std::to_string(field) + " = value " + std::to_string(sec * 31 + field) + "\n";
+  }
+  return content;
+}
+
+template <typename Fn>
+static double BestOf(const int repetitions, Fn fn) {
+  double best = 0;
+  for (int rep = 0; rep < repetitions; ++rep) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (rep == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+int main() {
+  const std::string content = MakeContent(50000, 40);
+  std::cout << "input size: " << content.size() / (1 << 20) << " MiB" << std::endl;
+
+  const double sequential = BestOf(3, [&]() {
+    ini::IniFile inif;
+    inif.Decode(content);
+  });
+  std::cout << "sequential: " << sequential << " ms" << std::endl;
+
+  const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 2; threads <= max_threads; threads *= 2) {
+    const double parallel = BestOf(3, [&]() {
+      ini::IniFile inif;
+      inif.DecodeParallel(content, threads);
+    });
+    std::cout << threads << " threads: " << parallel << " ms (speedup " << sequential / parallel << "x)" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+/* bench_snapshot_readers.cpp
+ *
+ * Compares read throughput of a mutex guarded shared_ptr and IniHolder readers
+ * while a writer publishes new files.
+ */
+
+#include <inicpp.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static ini::IniFile MakeFile(const int sections, const int fields) {
+  ini::IniFile inif;
+  for (int sec = 0; sec < sections; ++sec) {
+    ini::IniSection& section = inif["section_" + std::to_string(sec)];
+    for (int field = 0; field < fields; ++field)
+      section["key_" + std::to_string(field)] = sec * 31 + field;
+  }
+  return inif;
+}
+
+/** Runs readers on the given number of threads and returns the lookups per second. */
+template <typename MakeReader>
+static double Throughput(const unsigned threads, MakeReader make_reader) {
+  std::atomic<bool> done(false);
+  std::atomic<uint64_t> total(0);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i) {
+    workers.emplace_back([&]() {
+      auto read = make_reader();
+      uint64_t lookups = 0;
+      uint64_t checksum = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        checksum += read().at("section_7").at("key_3").template As<std::string>().size();
+        ++lookups;
+      }
+      total += lookups + (checksum == 0 ? 1 : 0);
+    });
+  }
+  const auto duration = std::chrono::milliseconds(500);
+  std::this_thread::sleep_for(duration);
+  done = true;
+  for (std::thread& worker : workers)
+    worker.join();
+  return total.load() / std::chrono::duration<double>(duration).count();
+}
+
+int main() {
+  const std::shared_ptr<const ini::IniFile> initial = std::make_shared<ini::IniFile>(MakeFile(100, 20));
+
+  std::mutex mutex;
+  std::shared_ptr<const ini::IniFile> guarded = initial;
+  ini::IniHolder holder(initial);
+
+  std::atomic<bool> stop_writer(false);
+  std::thread writer([&]() {
+    while (!stop_writer.load()) {
+      std::shared_ptr<const ini::IniFile> next = std::make_shared<ini::IniFile>(*initial);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        guarded = next;
+      }
+      holder.Publish(next);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+    const double locked = Throughput(threads, [&]() {
+      std::shared_ptr<const ini::IniFile> pinned;
+      return [&, pinned]() mutable -> const ini::IniFile& {
+        std::lock_guard<std::mutex> lock(mutex);
+        pinned = guarded;
+        return *pinned;
+      };
+    });
+    const double lock_free = Throughput(threads, [&]() {
+      std::shared_ptr<ini::IniHolder::Reader> reader = std::make_shared<ini::IniHolder::Reader>(holder);
+      return [reader]() -> const ini::IniFile& { return reader->Get(); };
+    });
+    std::cout << threads << " threads: mutex " << locked / 1e6 << " M/s, holder " << lock_free / 1e6 << " M/s"
+              << std::endl;
+  }
+
+  stop_writer = true;
+  writer.join();
+  return 0;
+}
@@ -11,18 +11,70 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <istream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <scoped_allocator>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #ifdef __cpp_lib_string_view  // This one is defined in <string> if we have std::string_view
 #include <string_view>
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define INICPP_HAS_MMAP 1
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#define INICPP_HAS_INOTIFY 1
+#endif
+
+// Define INICPP_FIELD_CACHE to cache the decoded value of each field, which
+// makes IniField 16 bytes larger. It must be defined the same way in every
+// translation unit.
+
+// SIMD line scanning, define INICPP_NO_SIMD to always use the scalar scanner.
+#ifndef INICPP_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INICPP_HAS_SSE2 1
+#endif
+#if defined(INICPP_HAS_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define INICPP_HAS_AVX2_DISPATCH 1
+#endif
+#endif
+
 // When exceptions are disabled (-fno-exceptions), replace throw with assert+return.
 #if defined(__cpp_exceptions)
 #define INICPP_THROW(exception_type, msg) throw exception_type(msg)
@@ -50,6 +102,11 @@ constexpr const char* Whitespaces() {
   return " \t\n\r\f\v";
 }
 
+/** Returns whether the given character is one of Whitespaces(). */
+inline bool IsWhitespace(const char c) {
+  return c != '\0' && std::strchr(Whitespaces(), c) != nullptr;
+}
+
 /** Returns a string of indentation characters. */
 constexpr const char* Indents() {
   return " \t";
@@ -72,555 +129,5468 @@ inline void Trim(std::string& str) {
   str.erase(0, str.find_first_not_of(Whitespaces()));
 }
 
-/************************************************
- * Conversion Functors
- ************************************************/
+#ifdef __cpp_lib_string_view
+using StringView = std::string_view;
+#else
+/** Minimal non-owning view of a character range, used when std::string_view
+ * is not available. Provides the subset of the std::string_view interface
+ * the parser relies on. */
+class StringView {
+ private:
+  const char* data_;
+  std::size_t size_;
 
-inline bool StrToLong(const std::string& value, long& result) {
-  char* endptr;
-  // check if decimal
-  result = std::strtol(value.c_str(), &endptr, 10);
-  if (*endptr == '\0')
-    return true;
-  // check if octal
-  result = std::strtol(value.c_str(), &endptr, 8);
-  if (*endptr == '\0')
-    return true;
-  // check if hex
-  result = std::strtol(value.c_str(), &endptr, 16);
-  if (*endptr == '\0')
-    return true;
+ public:
+  StringView() : data_(nullptr), size_(0) {}
+  StringView(const char* data, std::size_t size) : data_(data), size_(size) {}
+  StringView(const char* str) : data_(str), size_(std::strlen(str)) {}
+  StringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
 
-  return false;
-}
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  char operator[](std::size_t pos) const { return data_[pos]; }
 
-inline bool StrToULong(const std::string& value, unsigned long& result) {
-  char* endptr;
-  // check if decimal
-  result = std::strtoul(value.c_str(), &endptr, 10);
-  if (*endptr == '\0')
-    return true;
-  // check if octal
-  result = std::strtoul(value.c_str(), &endptr, 8);
-  if (*endptr == '\0')
-    return true;
-  // check if hex
-  result = std::strtoul(value.c_str(), &endptr, 16);
-  if (*endptr == '\0')
-    return true;
+  StringView substr(std::size_t pos, std::size_t count = std::string::npos) const {
+    return StringView(data_ + pos, std::min(count, size_ - pos));
+  }
 
-  return false;
+  explicit operator std::string() const { return std::string(data_, size_); }
+
+  friend bool operator==(StringView lhs, StringView rhs) {
+    return lhs.size_ == rhs.size_ && (lhs.size_ == 0 || std::memcmp(lhs.data_, rhs.data_, lhs.size_) == 0);
+  }
+
+  friend bool operator!=(StringView lhs, StringView rhs) { return !(lhs == rhs); }
+};
+#endif
+
+/** Trims whitespace from both ends of a string view.
+ * @param str view to be trimmed
+ * @return trimmed view into the same memory */
+inline StringView Trim(StringView str) {
+  const char* first = str.data();
+  const char* last = first + str.size();
+  while (first != last && IsWhitespace(*first))
+    ++first;
+  while (last != first && IsWhitespace(*(last - 1)))
+    --last;
+  return StringView(first, static_cast<std::size_t>(last - first));
 }
 
-template <typename T>
-struct Convert {};
+/** Throws std::out_of_range, used by lookups that return a reference and
+ * so cannot use INICPP_THROW directly. */
+inline void ThrowOutOfRange(const char* msg) { INICPP_THROW(std::out_of_range, msg); }
 
-template <>
-struct Convert<bool> {
-  void Decode(const std::string& value, bool& result) {
-    std::string str(value);
-    std::transform(str.begin(), str.end(), str.begin(), [](const char c) { return static_cast<char>(::toupper(c)); });
+/************************************************
+ * File Mapping
+ ************************************************/
 
-    if (str == "TRUE")
-      result = true;
-    else if (str == "FALSE")
-      result = false;
-    else
-      INICPP_THROW(std::invalid_argument, "field is not a bool");
-  }
+/** Read-only view of a file's contents. By default the contents are read
+ * into an internal buffer. With kMap, regular files are memory mapped on
+ * POSIX systems. Accessing a mapping after the file was truncated raises
+ * SIGBUS, so only files the caller controls should be mapped. */
+class MappedFile {
+ public:
+  enum Mode {
+    /** map regular files */
+    kMap,
+    /** read the contents into a private buffer */
+    kRead
+  };
 
-  void Encode(const bool value, std::string& result) { result = value ? "true" : "false"; }
-};
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  bool mapped_ = false;
+  bool open_ = false;
+  std::string buffer_;
 
-template <>
-struct Convert<char> {
-  void Decode(const std::string& value, char& result) {
-    assert(value.size() > 0);
-    result = value[0];
+  void UseBuffer() {
+    data_ = buffer_.data();
+    size_ = buffer_.size();
   }
 
-  void Encode(const char value, std::string& result) { result = value; }
-};
+ public:
+  explicit MappedFile(const std::string& file_name, const Mode mode = kRead) {
+#ifdef INICPP_HAS_MMAP
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    open_ = true;
 
-template <>
-struct Convert<unsigned char> {
-  void Decode(const std::string& value, unsigned char& result) {
-    assert(value.size() > 0);
-    result = value[0];
+    struct stat st;
+    const bool regular = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+    if (regular && mode == kMap) {
+      void* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+        ::madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+        data_ = static_cast<const char*>(addr);
+        size_ = static_cast<std::size_t>(st.st_size);
+        mapped_ = true;
+        ::close(fd);
+        return;
+      }
+    }
+
+    // not mappable (pipe, procfs, empty file, ...) or not to be mapped,
+    // read it instead; a file that shrinks meanwhile just reads shorter
+    if (regular)
+      buffer_.reserve(static_cast<std::size_t>(st.st_size));
+    char chunk[65536];
+    ssize_t count;
+    while ((count = ::read(fd, chunk, sizeof(chunk))) > 0 || (count < 0 && errno == EINTR)) {
+      if (count > 0)
+        buffer_.append(chunk, static_cast<std::size_t>(count));
+    }
+    ::close(fd);
+#else
+    (void)mode;
+    std::ifstream is(file_name.c_str(), std::ios::in | std::ios::binary);
+    if (!is.is_open())
+      return;
+    open_ = true;
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    buffer_ = ss.str();
+#endif
+    UseBuffer();
   }
 
-  void Encode(const unsigned char value, std::string& result) { result = value; }
-};
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
 
-template <>
-struct Convert<short> {
-  void Decode(const std::string& value, short& result) {
-    long tmp;
-    if (!StrToLong(value, tmp))
-      INICPP_THROW(std::invalid_argument, "field is not a short");
-    result = static_cast<short>(tmp);
+  ~MappedFile() {
+#ifdef INICPP_HAS_MMAP
+    if (mapped_)
+      ::munmap(const_cast<char*>(data_), size_);
+#endif
   }
 
-  void Encode(const short value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
-  }
+  /** Returns true if the file could be opened. */
+  bool IsOpen() const { return open_; }
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_; }
 };
 
-template <>
-struct Convert<unsigned short> {
-  void Decode(const std::string& value, unsigned short& result) {
-    unsigned long tmp;
-    if (!StrToULong(value, tmp))
-      INICPP_THROW(std::invalid_argument, "field is not an unsigned short");
-    result = static_cast<unsigned short>(tmp);
+/** Computes the 64-bit FNV-1a hash of the given bytes.
+ * @param data pointer to the first byte
+ * @param size number of bytes
+ * @param hash hash of preceding bytes to continue from */
+inline std::uint64_t Fnv1a(const char* data, const std::size_t size,
+                           std::uint64_t hash = 14695981039346656037ull) {
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
   }
+  return hash;
+}
 
-  void Encode(const unsigned short value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
+/** Computes a 64-bit hash of the given bytes eight bytes at a time. It is
+ * several times faster than Fnv1a on large inputs and meant to detect
+ * changed or corrupt file contents. Compiled snapshots store it, so a
+ * change of the hash needs a new CompiledHeader::kVersion. */
+inline std::uint64_t FastHash(const char* data, std::size_t size) {
+  std::uint64_t hash = 14695981039346656037ull ^ (static_cast<std::uint64_t>(size) * 0x9e3779b97f4a7c15ull);
+  for (; size >= 8; data += 8, size -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data, 8);
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 32;
   }
-};
+  return Fnv1a(data, size, hash);
+}
 
-template <>
-struct Convert<int> {
-  void Decode(const std::string& value, int& result) {
-    long tmp;
-    if (!StrToLong(value, tmp))
-      INICPP_THROW(std::invalid_argument, "field is not an int");
-    result = static_cast<int>(tmp);
-  }
+/** Spreads the bits of a hash over all 64 bits, so that both its low and
+ * its high bits can be used to index tables. */
+inline std::uint64_t MixHash(std::uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return hash;
+}
 
-  void Encode(const int value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
+/** Identity, size and modification time of a file. Fields that cannot be
+ * determined on a platform are 0. */
+struct FileStamp {
+  std::uint64_t device = 0;
+  std::uint64_t inode = 0;
+  std::uint64_t size = 0;
+  /** modification time in seconds */
+  std::int64_t mtime = 0;
+
+  bool operator==(const FileStamp& other) const {
+    return device == other.device && inode == other.inode && size == other.size && mtime == other.mtime;
   }
+  bool operator!=(const FileStamp& other) const { return !(*this == other); }
 };
 
-template <>
-struct Convert<unsigned int> {
-  void Decode(const std::string& value, unsigned int& result) {
-    unsigned long tmp;
-    if (!StrToULong(value, tmp))
-      INICPP_THROW(std::invalid_argument, "field is not an unsigned int");
-    result = static_cast<unsigned int>(tmp);
-  }
+/** Reads the stamp of the file at the given path.
+ * @return false if the file does not exist */
+inline bool StatFile(const std::string& file_name, FileStamp& stamp) {
+#ifdef INICPP_HAS_MMAP
+  struct stat info;
+  if (::stat(file_name.c_str(), &info) != 0)
+    return false;
+  stamp.device = static_cast<std::uint64_t>(info.st_dev);
+  stamp.inode = static_cast<std::uint64_t>(info.st_ino);
+  stamp.size = static_cast<std::uint64_t>(info.st_size);
+  stamp.mtime = static_cast<std::int64_t>(info.st_mtime);
+  return true;
+#else
+  std::ifstream is(file_name.c_str(), std::ios::binary | std::ios::ate);
+  if (!is.is_open())
+    return false;
+  stamp = FileStamp();
+  stamp.size = static_cast<std::uint64_t>(is.tellg());
+  return true;
+#endif
+}
 
-  void Encode(const unsigned int value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
-  }
-};
+/** Replaces the file at the given path with the given bytes. They are
+ * written to a new file with a unique name next to it, which is flushed to
+ * disk and renamed over the target, so readers see either the old or the
+ * new contents and concurrent saves never share a temporary file. A new
+ * file takes the permissions of the file it replaces. Without POSIX the
+ * target is moved aside while the new file is renamed into place.
+ * @return false if the file could not be replaced, the target is then
+ * unchanged and the temporary file is removed */
+inline bool ReplaceFile(const std::string& file_name, const char* data, std::size_t size) {
+#ifdef INICPP_HAS_MMAP
+  std::vector<char> temp_name(file_name.begin(), file_name.end());
+  const char suffix[] = ".XXXXXX";
+  temp_name.insert(temp_name.end(), suffix, suffix + sizeof(suffix));
+  const int fd = ::mkstemp(temp_name.data());
+  if (fd < 0)
+    return false;
 
-template <>
-struct Convert<long> {
-  void Decode(const std::string& value, long& result) {
-    if (!StrToLong(value, result))
-      INICPP_THROW(std::invalid_argument, "field is not a long");
+  bool ok = true;
+  struct stat info;
+  if (::stat(file_name.c_str(), &info) == 0)
+    ok = ::fchmod(fd, info.st_mode & 07777) == 0;
+  else
+    ok = ::fchmod(fd, 0644) == 0;
+  while (ok && size > 0) {
+    const ssize_t count = ::write(fd, data, size);
+    if (count < 0 && errno == EINTR)
+      continue;
+    ok = count > 0;
+    if (ok) {
+      data += count;
+      size -= static_cast<std::size_t>(count);
+    }
   }
-
-  void Encode(const long value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
+  ok = ok && ::fsync(fd) == 0;
+  ok = ::close(fd) == 0 && ok;
+  if (ok && ::rename(temp_name.data(), file_name.c_str()) == 0)
+    return true;
+  ::unlink(temp_name.data());
+  return false;
+#else
+  static std::atomic<unsigned> counter(0);
+  const std::string unique = std::to_string(static_cast<unsigned long long>(
+                                 std::chrono::steady_clock::now().time_since_epoch().count())) +
+                             "." + std::to_string(counter.fetch_add(1));
+  const std::string temp_name = file_name + ".tmp" + unique;
+  {
+    std::ofstream os(temp_name.c_str(), std::ios::binary | std::ios::trunc);
+    os.write(data, static_cast<std::streamsize>(size));
+    os.flush();
+    if (!os) {
+      os.close();
+      std::remove(temp_name.c_str());
+      return false;
+    }
   }
-};
-
-template <>
-struct Convert<unsigned long> {
-  void Decode(const std::string& value, unsigned long& result) {
-    if (!StrToULong(value, result))
-      INICPP_THROW(std::invalid_argument, "field is not an unsigned long");
+  if (std::rename(temp_name.c_str(), file_name.c_str()) == 0)
+    return true;
+  // renaming over an existing file fails on some platforms, the old file
+  // is kept until the new one is in place
+  const std::string old_name = file_name + ".old" + unique;
+  if (std::rename(file_name.c_str(), old_name.c_str()) == 0) {
+    if (std::rename(temp_name.c_str(), file_name.c_str()) == 0) {
+      std::remove(old_name.c_str());
+      return true;
+    }
+    std::rename(old_name.c_str(), file_name.c_str());
   }
+  std::remove(temp_name.c_str());
+  return false;
+#endif
+}
 
-  void Encode(const unsigned long value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
-  }
-};
+/************************************************
+ * Comment Prefix Matcher
+ ************************************************/
 
-template <>
-struct Convert<double> {
-  void Decode(const std::string& value, double& result) { result = std::stod(value); }
+/** Set of comment prefixes compiled into a first byte bitmap and a trie.
+ * Matching at a position costs one bitmap lookup for bytes that cannot
+ * start a prefix and at most one trie step per byte of the longest prefix
+ * otherwise, independent of the number of prefixes. */
+class CommentPrefixMatcher {
+ private:
+  struct Node {
+    /** index of the child node for each byte, 0 if there is none */
+    std::uint32_t next[256];
+    /** length of the prefix ending at this node */
+    std::size_t length;
+    /** position of that prefix in the prefix list, or npos */
+    std::size_t order;
+  };
 
-  void Encode(const double value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
-  }
-};
+  std::vector<Node> nodes_;
+  std::uint32_t first_bytes_[8];
+  bool match_empty_ = false;
 
-template <>
-struct Convert<float> {
-  void Decode(const std::string& value, float& result) { result = std::stof(value); }
+  bool IsFirstByte(const unsigned char byte) const { return (first_bytes_[byte >> 5] >> (byte & 31u)) & 1u; }
 
-  void Encode(const float value, std::string& result) {
-    std::stringstream ss;
-    ss << value;
-    result = ss.str();
+ public:
+  explicit CommentPrefixMatcher(const std::vector<std::string>& prefixes) : nodes_(1) {
+    std::memset(first_bytes_, 0, sizeof(first_bytes_));
+    std::memset(nodes_[0].next, 0, sizeof(nodes_[0].next));
+    nodes_[0].length = 0;
+    nodes_[0].order = std::string::npos;
+
+    for (std::size_t i = 0; i < prefixes.size(); ++i) {
+      const std::string& prefix = prefixes[i];
+      if (prefix.empty()) {
+        match_empty_ = true;
+        continue;
+      }
+      const unsigned char first = static_cast<unsigned char>(prefix[0]);
+      first_bytes_[first >> 5] |= 1u << (first & 31u);
+
+      std::size_t node = 0;
+      for (const char c : prefix) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (nodes_[node].next[byte] == 0) {
+          nodes_[node].next[byte] = static_cast<std::uint32_t>(nodes_.size());
+          nodes_.push_back(Node());
+          std::memset(nodes_.back().next, 0, sizeof(nodes_.back().next));
+          nodes_.back().length = 0;
+          nodes_.back().order = std::string::npos;
+        }
+        node = nodes_[node].next[byte];
+      }
+      // the earlier prefix wins if the same prefix is listed twice
+      if (nodes_[node].order == std::string::npos) {
+        nodes_[node].length = prefix.size();
+        nodes_[node].order = i;
+      }
+    }
   }
-};
 
-template <>
-struct Convert<std::string> {
-  void Decode(const std::string& value, std::string& result) { result = value; }
+  /** Returns true if the byte may start a comment prefix. */
+  bool MayStart(const char c) const { return match_empty_ || IsFirstByte(static_cast<unsigned char>(c)); }
 
-  void Encode(const std::string& value, std::string& result) { result = value; }
+  /** Returns the length of the comment prefix starting at pos, or
+   * std::string::npos if none does. If several prefixes match, the one
+   * listed first wins. */
+  std::size_t Match(const char* pos, const char* end) const {
+    if (match_empty_)
+      return 0;
+    if (pos == end || !IsFirstByte(static_cast<unsigned char>(*pos)))
+      return std::string::npos;
+
+    std::size_t best_order = std::string::npos;
+    std::size_t best_length = std::string::npos;
+    std::size_t node = 0;
+    for (; pos != end; ++pos) {
+      node = nodes_[node].next[static_cast<unsigned char>(*pos)];
+      if (node == 0)
+        break;
+      if (nodes_[node].order < best_order) {
+        best_order = nodes_[node].order;
+        best_length = nodes_[node].length;
+      }
+    }
+    return best_length;
+  }
 };
 
-#ifdef __cpp_lib_string_view
-template <>
-struct Convert<std::string_view> {
-  void Decode(const std::string& value, std::string_view& result) { result = value; }
+/************************************************
+ * Line Scanner
+ ************************************************/
 
-  void Encode(const std::string_view value, std::string& result) { result = value; }
-};
+/** Returns the index of the lowest set bit of a non-zero mask. */
+inline unsigned CountTrailingZeros(const std::uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+  unsigned count = 0;
+  for (std::uint32_t m = mask; (m & 1u) == 0; m >>= 1)
+    ++count;
+  return count;
 #endif
+}
 
-template <>
-struct Convert<const char*> {
-  void Encode(const char* const& value, std::string& result) { result = value; }
-
-  void Decode(const std::string& value, const char*& result) { result = value.c_str(); }
+/** Single line of input as found by the LineScanner. Pointers refer to the
+ * first occurrence of the respective character within the line and are
+ * nullptr if it does not occur. */
+struct LineTokens {
+  /** line contents without the terminating '\n' */
+  StringView line;
+  /** first character that may start a comment prefix */
+  const char* comment = nullptr;
+  /** first field separator */
+  const char* field_sep = nullptr;
+  /** first ']' */
+  const char* section_end = nullptr;
 };
 
-template <>
-struct Convert<char*> {
-  void Encode(const char* const& value, std::string& result) { result = value; }
-};
+/** Splits a buffer into lines and locates newline, comment prefix starts,
+ * field separator and section end in a single pass. On x86 the buffer is
+ * classified 16 bytes at a time with SSE2, or 32 bytes at a time with AVX2
+ * if the CPU supports it, other platforms use a table driven scalar loop. */
+class LineScanner {
+ private:
+  enum : std::uint8_t { kNewline = 1, kComment = 2, kFieldSep = 4, kSectionEnd = 8 };
 
-template <size_t n>
-struct Convert<char[n]> {
-  void Encode(const char* value, std::string& result) { result = value; }
-};
+  /** Bit masks of the character classes within one block, bit i refers to
+   * the i-th byte of the block. */
+  struct BlockMasks {
+    std::uint32_t newline;
+    std::uint32_t comment;
+    std::uint32_t field_sep;
+    std::uint32_t section_end;
+  };
 
-class IniField {
- private:
-  std::string value_;
+  static constexpr std::size_t kMaxCommentBytes = 8;
+
+  std::uint8_t classes_[256];
+  char field_sep_;
+  char comment_bytes_[kMaxCommentBytes];
+  std::size_t comment_byte_count_ = 0;
+  bool all_comment_ = false;
+  bool use_simd_ = false;
+  bool use_avx2_ = false;
+
+  /** Records the first occurrence of each class within the given block,
+   * considering only bytes in front of a newline. Returns true if the block
+   * contains the end of the line. */
+  static bool Record(const char* block, const BlockMasks& masks, LineTokens& tokens, const char*& eol) {
+    std::uint32_t before = ~0u;
+    if (masks.newline != 0) {
+      const unsigned pos = CountTrailingZeros(masks.newline);
+      before = (1u << pos) - 1u;
+      eol = block + pos;
+    }
+    if (tokens.comment == nullptr && (masks.comment & before) != 0)
+      tokens.comment = block + CountTrailingZeros(masks.comment & before);
+    if (tokens.field_sep == nullptr && (masks.field_sep & before) != 0)
+      tokens.field_sep = block + CountTrailingZeros(masks.field_sep & before);
+    if (tokens.section_end == nullptr && (masks.section_end & before) != 0)
+      tokens.section_end = block + CountTrailingZeros(masks.section_end & before);
+    return masks.newline != 0;
+  }
+
+#ifdef INICPP_HAS_SSE2
+  struct Sse2Kernel {
+    static constexpr std::size_t kWidth = 16;
+
+    static BlockMasks Classify(const LineScanner& scanner, const char* block) {
+      const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+      __m128i comment = _mm_setzero_si128();
+      for (std::size_t i = 0; i < scanner.comment_byte_count_; ++i)
+        comment = _mm_or_si128(comment, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(scanner.comment_bytes_[i])));
+      BlockMasks masks;
+      masks.newline = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+      masks.comment = static_cast<std::uint32_t>(_mm_movemask_epi8(comment));
+      masks.field_sep =
+          static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(scanner.field_sep_))));
+      masks.section_end = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(']'))));
+      return masks;
+    }
+  };
+#endif
+
+#ifdef INICPP_HAS_AVX2_DISPATCH
+  struct Avx2Kernel {
+    static constexpr std::size_t kWidth = 32;
+
+    __attribute__((target("avx2"))) static BlockMasks Classify(const LineScanner& scanner, const char* block) {
+      const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+      __m256i comment = _mm256_setzero_si256();
+      for (std::size_t i = 0; i < scanner.comment_byte_count_; ++i)
+        comment = _mm256_or_si256(comment, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(scanner.comment_bytes_[i])));
+      BlockMasks masks;
+      masks.newline =
+          static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+      masks.comment = static_cast<std::uint32_t>(_mm256_movemask_epi8(comment));
+      masks.field_sep = static_cast<std::uint32_t>(
+          _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(scanner.field_sep_))));
+      masks.section_end =
+          static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(']'))));
+      return masks;
+    }
+  };
+
+  static bool CpuHasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") != 0;
+    return has_avx2;
+  }
+#endif
+
+  template <typename Kernel>
+  const char* ScanBlocks(const char* pos, const char* end, LineTokens& tokens) const {
+    const char* eol = nullptr;
+    while (static_cast<std::size_t>(end - pos) >= Kernel::kWidth) {
+      if (Record(pos, Kernel::Classify(*this, pos), tokens, eol))
+        return eol;
+      pos += Kernel::kWidth;
+    }
+    return ScanScalar(pos, end, tokens);
+  }
+
+  const char* ScanScalar(const char* pos, const char* end, LineTokens& tokens) const {
+    for (; pos != end; ++pos) {
+      const std::uint8_t cls = classes_[static_cast<unsigned char>(*pos)];
+      if (cls == 0)
+        continue;
+      if ((cls & kNewline) != 0)
+        return pos;
+      if ((cls & kComment) != 0 && tokens.comment == nullptr)
+        tokens.comment = pos;
+      if ((cls & kFieldSep) != 0 && tokens.field_sep == nullptr)
+        tokens.field_sep = pos;
+      if ((cls & kSectionEnd) != 0 && tokens.section_end == nullptr)
+        tokens.section_end = pos;
+    }
+    return nullptr;
+  }
+
+ public:
+  /** @param field_sep field separator character
+   * @param comment_prefixes comment prefixes, their first characters are located
+   * @param allow_simd use vector instructions if the platform supports them */
+  LineScanner(const char field_sep, const std::vector<std::string>& comment_prefixes, const bool allow_simd = true)
+      : field_sep_(field_sep) {
+    std::memset(classes_, 0, sizeof(classes_));
+    classes_[static_cast<unsigned char>('\n')] |= kNewline;
+    classes_[static_cast<unsigned char>(field_sep)] |= kFieldSep;
+    classes_[static_cast<unsigned char>(']')] |= kSectionEnd;
+    bool fits_simd = true;
+    for (const std::string& prefix : comment_prefixes) {
+      // an empty prefix matches everywhere
+      if (prefix.empty()) {
+        all_comment_ = true;
+        continue;
+      }
+      std::uint8_t& cls = classes_[static_cast<unsigned char>(prefix[0])];
+      if ((cls & kComment) != 0)
+        continue;
+      cls |= kComment;
+      if (comment_byte_count_ < kMaxCommentBytes)
+        comment_bytes_[comment_byte_count_++] = prefix[0];
+      else
+        fits_simd = false;
+    }
+#ifdef INICPP_HAS_SSE2
+    use_simd_ = allow_simd && fits_simd;
+#else
+    (void)allow_simd;
+    (void)fits_simd;
+#endif
+#ifdef INICPP_HAS_AVX2_DISPATCH
+    use_avx2_ = use_simd_ && CpuHasAvx2();
+#endif
+  }
+
+  /** Scans the line starting at begin.
+   * @param begin start of the line
+   * @param end end of the buffer
+   * @param tokens receives the line and the positions of its tokens
+   * @return true if the line was terminated by '\n', false if it was the last line */
+  bool ScanLine(const char* begin, const char* end, LineTokens& tokens) const {
+    tokens.comment = nullptr;
+    tokens.field_sep = nullptr;
+    tokens.section_end = nullptr;
+
+    const char* eol;
+#if defined(INICPP_HAS_AVX2_DISPATCH)
+    if (use_avx2_)
+      eol = ScanBlocks<Avx2Kernel>(begin, end, tokens);
+    else if (use_simd_)
+      eol = ScanBlocks<Sse2Kernel>(begin, end, tokens);
+    else
+      eol = ScanScalar(begin, end, tokens);
+#elif defined(INICPP_HAS_SSE2)
+    if (use_simd_)
+      eol = ScanBlocks<Sse2Kernel>(begin, end, tokens);
+    else
+      eol = ScanScalar(begin, end, tokens);
+#else
+    eol = ScanScalar(begin, end, tokens);
+#endif
+
+    const bool terminated = eol != nullptr;
+    if (!terminated)
+      eol = end;
+    tokens.line = StringView(begin, static_cast<std::size_t>(eol - begin));
+    if (all_comment_)
+      tokens.comment = begin;
+    return terminated;
+  }
+};
+
+/************************************************
+ * Event Parser
+ ************************************************/
+
+/** Kinds of errors found while parsing. */
+enum class ParseErrorCode {
+  /** a section header lacks its closing ']' */
+  kSectionNotClosed,
+  /** a section header has an empty name */
+  kSectionEmpty,
+  /** a field appears before the first section */
+  kFieldWithoutSection,
+  /** a line is neither a section, a field nor a continuation */
+  kMissingFieldSep,
+  /** a field already exists in its section, reported by handlers that
+   * do not allow overwriting fields */
+  kDuplicateField,
+  /** the file could not be read or watched, reported with line 0 */
+  kReadFailed
+};
+
+/** Location and kind of an error found while parsing. */
+struct ParseError {
+  /** 1-based line number */
+  int line;
+  /** 1-based column of the start of the line's content, 0 if unknown */
+  int column;
+  ParseErrorCode code;
+};
+
+/** How a non-throwing decode continues after an error. */
+enum class ErrorRecovery {
+  /** stop at the first error */
+  kStop,
+  /** skip malformed lines and duplicate fields, and the fields after a
+   * malformed section header up to the next header */
+  kSkipBadLines
+};
+
+/** Outcome of a non-throwing decode. */
+struct DecodeResult {
+  /** errors in the order they were found */
+  std::vector<ParseError> errors;
+
+  /** @return true if no error was found */
+  bool Ok() const { return errors.empty(); }
+  explicit operator bool() const { return Ok(); }
+};
+
+/** Predicate that selects the sections to decode by name. */
+using SectionFilter = std::function<bool(StringView)>;
+
+/** Returns a short description of the given error code. */
+inline const char* ErrorMessage(const ParseErrorCode code) {
+  switch (code) {
+    case ParseErrorCode::kSectionNotClosed:
+      return "section not closed";
+    case ParseErrorCode::kSectionEmpty:
+      return "section is empty";
+    case ParseErrorCode::kFieldWithoutSection:
+      return "field has no section";
+    case ParseErrorCode::kMissingFieldSep:
+      return "no field separator found";
+    case ParseErrorCode::kDuplicateField:
+      return "duplicate field found";
+    case ParseErrorCode::kReadFailed:
+      return "file could not be read";
+  }
+  return "unknown error";
+}
+
+/** Handler for IniParser events that ignores everything and stops at the
+ * first error. Derive from it and hide the events of interest. Each event
+ * returns true to continue parsing or false to stop. */
+struct IniHandler {
+  /** A section header [name] was found. Returning false skips the section:
+   * no events are reported for it, and unless '[' can start a comment its
+   * lines are passed over by looking only at their first character. */
+  bool SelectSection(int /* line */, StringView /* name */) { return true; }
+  /** A selected section header [name] was found. */
+  bool OnSection(int /* line */, StringView /* name */) { return true; }
+  /** A field name=value was found, both are trimmed. A handler that
+   * declares OnField(int line, int column, StringView name, StringView
+   * value) instead also receives the 1-based column of the name. */
+  bool OnField(int /* line */, StringView /* name */, StringView /* value */) { return true; }
+  /** A continuation line of the multi-line value of the last field was
+   * found, the value has to be appended after a '\n'. */
+  bool OnContinuation(int /* line */, StringView /* value */) { return true; }
+  /** A comment was found, the text starts with the comment prefix. */
+  bool OnComment(int /* line */, StringView /* text */) { return true; }
+  /** A malformed line was found. Returning true skips the line; after a
+   * malformed section header the fields up to the next header are skipped
+   * as well. */
+  bool OnError(const ParseError& /* error */) { return false; }
+};
+
+/** Push parser for the ini grammar. It holds the parse options and reports
+ * sections, fields, continuations, comments and errors to a handler as
+ * views into the input (or into a scratch buffer for lines with escaped
+ * comment prefixes) without building any container. */
+template <typename Handler>
+class IniFeedParser;
+
+class IniParser {
+ private:
+  template <typename Handler>
+  friend class IniFeedParser;
+
+  /** State that is carried from one line to the next. */
+  struct State {
+    int line_no = 0;
+    /** column of the first non-whitespace character of the line */
+    int column = 0;
+    /** a section header was seen */
+    bool in_section = false;
+    /** the last section header was malformed, skip its fields */
+    bool skip_section = false;
+    /** the last line was a field that multi-line values may continue */
+    bool can_continue = false;
+    /** the handler did not select the current section */
+    bool deselected = false;
+  };
+
+  char field_sep_ = '=';
+  char esc_ = '\\';
+  std::vector<std::string> comment_prefixes_ = {"#", ";"};
+  std::shared_ptr<const CommentPrefixMatcher> comment_matcher_ = CompileCommentPrefixes(comment_prefixes_);
+  bool multi_line_values_ = false;
+
+  /** Compiles the given comment prefixes. The compiled default prefixes are
+   * shared by all parsers that do not change them. */
+  static std::shared_ptr<const CommentPrefixMatcher> CompileCommentPrefixes(const std::vector<std::string>& prefixes) {
+    static const std::vector<std::string> default_prefixes = {"#", ";"};
+    static const std::shared_ptr<const CommentPrefixMatcher> default_matcher =
+        std::make_shared<CommentPrefixMatcher>(default_prefixes);
+    if (prefixes == default_prefixes)
+      return default_matcher;
+    return std::make_shared<CommentPrefixMatcher>(prefixes);
+  }
+
+  template <typename Handler>
+  static bool Fail(State& state, const ParseErrorCode code, Handler& handler) {
+    state.can_continue = false;
+    if (code == ParseErrorCode::kSectionNotClosed || code == ParseErrorCode::kSectionEmpty) {
+      state.in_section = true;
+      state.skip_section = true;
+      state.deselected = false;
+    }
+    ParseError error;
+    error.line = state.line_no;
+    error.column = state.column;
+    error.code = code;
+    return handler.OnError(error);
+  }
+
+  /** Reports a field to a handler that wants the column of its name. */
+  template <typename Handler>
+  static auto CallOnField(Handler& handler, const int line, const int column, const StringView name,
+                          const StringView value, int /* preferred */)
+      -> decltype(handler.OnField(line, column, name, value)) {
+    return handler.OnField(line, column, name, value);
+  }
+
+  template <typename Handler>
+  static bool CallOnField(Handler& handler, const int line, int /* column */, const StringView name,
+                          const StringView value, long /* fallback */) {
+    return handler.OnField(line, name, value);
+  }
+
+  template <typename Handler>
+  bool ParseLine(const LineTokens& tokens, State& state, std::string& scratch, Handler& handler) const {
+    StringView line = tokens.line;
+    const char* close = tokens.section_end;
+    const char* sep = tokens.field_sep;
+    StringView comment;
+    if (tokens.comment != nullptr) {
+      const char* comment_start = StripComment(line, scratch);
+      if (comment_start != nullptr)
+        comment = Trim(StringView(comment_start, static_cast<std::size_t>(line.end() - comment_start)));
+      line = StringView(scratch);
+      close = static_cast<const char*>(std::memchr(scratch.data(), ']', scratch.size()));
+      sep = static_cast<const char*>(std::memchr(scratch.data(), field_sep_, scratch.size()));
+    }
+    const bool has_indent = line.empty() || line[0] == ' ' || line[0] == '\t';
+    const char* const line_begin = line.data();
+    line = Trim(line);
+    ++state.line_no;
+    state.column = static_cast<int>(line.data() - line_begin) + 1;
+
+    if (!line.empty()) {
+      // a whitespace separator may have been trimmed away
+      if (sep != nullptr && sep < line.data())
+        sep = static_cast<const char*>(std::memchr(line.data(), field_sep_, line.size()));
+      else if (sep != nullptr && sep >= line.end())
+        sep = nullptr;
+
+      if (!ParseContent(line, has_indent, close, sep, state, handler))
+        return false;
+    }
+
+    return comment.empty() || state.deselected || handler.OnComment(state.line_no, comment);
+  }
+
+  template <typename Handler>
+  bool ParseContent(const StringView line, const bool has_indent, const char* close, const char* sep, State& state,
+                    Handler& handler) const {
+    if (line[0] == '[') {
+      // line is a section, it has to be closed on the same line
+      if (close == nullptr)
+        return Fail(state, ParseErrorCode::kSectionNotClosed, handler);
+      if (close == line.data() + 1)
+        return Fail(state, ParseErrorCode::kSectionEmpty, handler);
+
+      state.in_section = true;
+      // a new section means there is no value to continue
+      state.can_continue = false;
+      const StringView name(line.data() + 1, static_cast<std::size_t>(close - line.data() - 1));
+      state.deselected = !handler.SelectSection(state.line_no, name);
+      state.skip_section = state.deselected;
+      return state.deselected || handler.OnSection(state.line_no, name);
+    }
+
+    // line is a field definition or continuation
+    if (!state.in_section)
+      return Fail(state, ParseErrorCode::kFieldWithoutSection, handler);
+    if (state.skip_section)
+      return true;
+    if (multi_line_values_ && has_indent && state.can_continue)
+      return handler.OnContinuation(state.line_no, line);
+    if (sep == nullptr)
+      return Fail(state, ParseErrorCode::kMissingFieldSep, handler);
+
+    const StringView name = Trim(StringView(line.data(), static_cast<std::size_t>(sep - line.data())));
+    const StringView value = Trim(StringView(sep + 1, static_cast<std::size_t>(line.end() - sep - 1)));
+    // fields with an empty name cannot be continued
+    state.can_continue = !name.empty();
+    // the line is trimmed, so the name starts at the column of the line
+    return CallOnField(handler, state.line_no, state.column, name, value, 0);
+  }
+
+  /** Passes over the lines of a section that is not selected, up to the
+   * next line whose first non-whitespace character is '['. A trailing line
+   * without '\n' is only passed over if final is set.
+   * @return start of the next line to parse, or end */
+  static const char* SkipSection(const char* pos, const char* const end, const bool final, State& state) {
+    while (pos != end) {
+      const char* first = pos;
+      while (first != end && *first != '\n' && IsWhitespace(*first))
+        ++first;
+      if (first != end && *first == '[')
+        return pos;
+      const char* newline = nullptr;
+      if (first != end)
+        newline = static_cast<const char*>(std::memchr(first, '\n', static_cast<std::size_t>(end - first)));
+      if (newline == nullptr)
+        return final ? end : pos;
+      ++state.line_no;
+      pos = newline + 1;
+    }
+    return pos;
+  }
+
+  /** Parses the lines of the given buffer. A trailing line without '\n' is
+   * only parsed if final is set, consumed receives the number of characters
+   * of the lines that were parsed. */
+  template <typename Handler>
+  bool ParseLines(const LineScanner& scanner, const char* data, const std::size_t size, const bool final,
+                  State& state, std::string& scratch, Handler& handler, std::size_t& consumed) const {
+    LineTokens tokens;
+    const char* pos = data;
+    const char* const end = data + size;
+    // without comments that start with '[' a section ends at the next line
+    // whose first non-whitespace character is '['
+    const bool can_skip = !comment_matcher_->MayStart('[');
+    for (;;) {
+      if (state.deselected && can_skip)
+        pos = SkipSection(pos, end, final, state);
+      const bool complete = scanner.ScanLine(pos, end, tokens);
+      if (!complete && !final)
+        break;
+      if (!ParseLine(tokens, state, scratch, handler)) {
+        consumed = static_cast<std::size_t>(tokens.line.end() - data);
+        return false;
+      }
+      if (!complete)
+        break;
+      pos = tokens.line.end() + 1;
+    }
+    consumed = static_cast<std::size_t>(pos - data);
+    return true;
+  }
+
+ public:
+  IniParser() = default;
+
+  IniParser(const char field_sep, const std::vector<std::string>& comment_prefixes)
+      : field_sep_(field_sep), comment_prefixes_(comment_prefixes) {}
+
+  /** Sets the separator character for fields. Default is '='. */
+  void SetFieldSep(const char sep) { field_sep_ = sep; }
+
+  /** Sets the strings that start comments. Default is [ "#", ";" ]. */
+  void SetCommentPrefixes(const std::vector<std::string>& comment_prefixes) {
+    comment_prefixes_ = comment_prefixes;
+    comment_matcher_ = CompileCommentPrefixes(comment_prefixes_);
+  }
+
+  /** Sets the character that escapes comment prefixes. Default is '\\'. */
+  void SetEscapeChar(const char esc) { esc_ = esc; }
+
+  /** Sets whether indented lines continue the value of the previous field.
+   * Default is false. */
+  void SetMultiLineValues(const bool enable) { multi_line_values_ = enable; }
+
+  char FieldSep() const { return field_sep_; }
+  char EscapeChar() const { return esc_; }
+  const std::vector<std::string>& CommentPrefixes() const { return comment_prefixes_; }
+  const CommentPrefixMatcher& CommentMatcher() const { return *comment_matcher_; }
+  bool MultiLineValues() const { return multi_line_values_; }
+
+  /** Writes the given line without its comment to out. Escaped comment
+   * prefixes are kept and their escape char is dropped. The line is scanned
+   * once from left to right, so the cost is linear in its length no matter
+   * how many escaped prefixes it contains.
+   * @return start of the comment within line, or nullptr if there is none */
+  const char* StripComment(const StringView line, std::string& out) const {
+    out.clear();
+    const char* pos = line.data();
+    const char* const end = pos + line.size();
+    // start of the pending run of characters that are copied unchanged
+    const char* run = pos;
+    while (pos != end) {
+      const std::size_t prefix_len = comment_matcher_->Match(pos, end);
+      if (prefix_len != std::string::npos)
+        break;
+      if (*pos == esc_ && pos + 1 != end) {
+        const std::size_t escaped_len = comment_matcher_->Match(pos + 1, end);
+        if (escaped_len != std::string::npos && escaped_len != 0) {
+          // drop the escape char and keep the prefix
+          out.append(run, pos);
+          run = pos + 1;
+          pos += 1 + escaped_len;
+          continue;
+        }
+      }
+      ++pos;
+    }
+    out.append(run, pos);
+    return pos != end ? pos : nullptr;
+  }
+
+  /** Returns the character of line that StripComment writes at the given
+   * offset of its output, or the end of the stripped part of line if the
+   * offset is the size of the output. An escaped prefix maps to its escape
+   * char at its first offset, so a range of the output maps to the range
+   * of line it was written from. */
+  const char* StrippedPosition(const StringView line, const std::size_t offset) const {
+    const char* pos = line.data();
+    const char* const end = pos + line.size();
+    std::size_t written = 0;
+    while (pos != end && written < offset) {
+      if (comment_matcher_->Match(pos, end) != std::string::npos)
+        break;
+      if (*pos == esc_ && pos + 1 != end) {
+        const std::size_t escaped_len = comment_matcher_->Match(pos + 1, end);
+        if (escaped_len != std::string::npos && escaped_len != 0) {
+          if (offset - written < escaped_len)
+            return pos + 1 + (offset - written);
+          written += escaped_len;
+          pos += 1 + escaped_len;
+          continue;
+        }
+      }
+      ++written;
+      ++pos;
+    }
+    return pos;
+  }
+
+  /** Writes str so that parsing it gives str again: comment prefixes are
+   * escaped, and if multi-line values are enabled a '\t' follows each
+   * '\n'. The output is passed to write(const char* data, std::size_t size)
+   * in runs. */
+  template <typename Write>
+  void Escape(const StringView str, Write&& write) const {
+    const char* pos = str.data();
+    const char* const end = pos + str.size();
+    // start of the pending run of characters that are written unchanged
+    const char* run = pos;
+    while (pos != end) {
+      if (comment_matcher_->MayStart(*pos)) {
+        const std::size_t prefix_len = comment_matcher_->Match(pos, end);
+        if (prefix_len != std::string::npos && prefix_len != 0) {
+          write(run, static_cast<std::size_t>(pos - run));
+          write(&esc_, 1);
+          write(pos, prefix_len);
+          pos += prefix_len;
+          run = pos;
+          continue;
+        }
+      }
+      if (multi_line_values_ && *pos == '\n') {
+        write(run, static_cast<std::size_t>(pos - run));
+        write("\n\t", 2);
+        run = pos + 1;
+      }
+      ++pos;
+    }
+    write(run, static_cast<std::size_t>(end - run));
+  }
+
+  /** Parses the given character buffer and reports its contents to the
+   * handler. A trailing line without '\n' is also parsed.
+   * @param data pointer to the first character of the buffer
+   * @param size number of characters in the buffer
+   * @param handler receives the events, see IniHandler
+   * @param first_line number of the first line, for parsing a part of a
+   * larger buffer
+   * @return false if the handler stopped parsing */
+  template <typename Handler>
+  bool Parse(const char* data, const std::size_t size, Handler& handler, const int first_line = 1) const {
+    State state;
+    state.line_no = first_line - 1;
+    std::string scratch;
+    LineScanner scanner(field_sep_, comment_prefixes_);
+    std::size_t consumed;
+    return ParseLines(scanner, data, size, true, state, scratch, handler, consumed);
+  }
+
+  /** Parses the given string, see Parse(const char*, std::size_t, Handler&). */
+  template <typename Handler>
+  bool Parse(const std::string& content, Handler& handler) const {
+    return Parse(content.data(), content.size(), handler);
+  }
+
+  /** Reads the file at the given path in chunks and parses it through an
+   * IniFeedParser, so memory use does not grow with the size of the file.
+   * A file that cannot be opened is parsed as empty.
+   * @return false if the handler stopped parsing */
+  template <typename Handler>
+  bool ParseFile(const std::string& file_name, Handler& handler) const {
+    IniFeedParser<Handler> feed(*this, handler);
+    char chunk[65536];
+#ifdef INICPP_HAS_MMAP
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+      return feed.Finish();
+    ssize_t count;
+    while ((count = ::read(fd, chunk, sizeof(chunk))) > 0 || (count < 0 && errno == EINTR)) {
+      if (count > 0 && !feed.Feed(chunk, static_cast<std::size_t>(count))) {
+        ::close(fd);
+        return false;
+      }
+    }
+    ::close(fd);
+#else
+    std::ifstream is(file_name.c_str(), std::ios::in | std::ios::binary);
+    while (is.read(chunk, sizeof(chunk)) || is.gcount() > 0) {
+      if (!feed.Feed(chunk, static_cast<std::size_t>(is.gcount())))
+        return false;
+    }
+#endif
+    return feed.Finish();
+  }
+};
+
+/** Returns the message of the exception thrown for a parse error. */
+inline std::string DescribeParseError(const ParseError& error, const IniParser& parser) {
+  std::stringstream ss;
+  ss << "l." << error.line << ": ini parsing failed, ";
+  switch (error.code) {
+    case ParseErrorCode::kFieldWithoutSection:
+      ss << "field has no section or ini file in use by another application";
+      break;
+    case ParseErrorCode::kMissingFieldSep:
+      ss << "no '" << parser.FieldSep() << "' found";
+      if (parser.MultiLineValues())
+        ss << ", and not a multi-line value continuation";
+      break;
+    default:
+      ss << ErrorMessage(error.code);
+      break;
+  }
+  return ss.str();
+}
+
+/** Resumable front end of IniParser for input that arrives in chunks of
+ * arbitrary size, e.g. from a non-blocking socket. Complete lines are parsed
+ * in place as soon as they arrive; only a line that spans chunk boundaries
+ * is buffered until its '\n' is seen. Multi-line values and escaped comment
+ * prefixes may span chunks as well. */
+template <typename Handler>
+class IniFeedParser {
+ private:
+  IniParser parser_;
+  Handler& handler_;
+  LineScanner scanner_;
+  IniParser::State state_;
+  std::string scratch_;
+  // start of a line whose '\n' has not been fed yet
+  std::string pending_;
+  bool stopped_ = false;
+
+ public:
+  /** @param parser parser whose options are used, it is copied
+   * @param handler receives the events, see IniHandler */
+  IniFeedParser(const IniParser& parser, Handler& handler)
+      : parser_(parser), handler_(handler), scanner_(parser.FieldSep(), parser.CommentPrefixes()) {}
+
+  /** Parses all lines that are completed by the given chunk.
+   * @param data pointer to the first character of the chunk
+   * @param size number of characters in the chunk
+   * @return false if the handler stopped parsing, later calls do nothing */
+  bool Feed(const char* data, std::size_t size) {
+    if (stopped_)
+      return false;
+    std::size_t consumed;
+    if (!pending_.empty()) {
+      const char* newline = size == 0 ? nullptr : static_cast<const char*>(std::memchr(data, '\n', size));
+      if (newline == nullptr) {
+        pending_.append(data, size);
+        return true;
+      }
+      const std::size_t head = static_cast<std::size_t>(newline - data) + 1;
+      pending_.append(data, head);
+      stopped_ = !parser_.ParseLines(scanner_, pending_.data(), pending_.size(), false, state_, scratch_, handler_,
+                                     consumed);
+      pending_.clear();
+      if (stopped_)
+        return false;
+      data += head;
+      size -= head;
+    }
+    stopped_ = !parser_.ParseLines(scanner_, data, size, false, state_, scratch_, handler_, consumed);
+    if (!stopped_)
+      pending_.assign(data + consumed, size - consumed);
+    return !stopped_;
+  }
+
+  /** Parses the last line if it did not end with '\n' and resets the parser
+   * so it can be fed a new input.
+   * @return false if the handler stopped parsing */
+  bool Finish() {
+    bool result = !stopped_;
+    if (result) {
+      std::size_t consumed;
+      result = parser_.ParseLines(scanner_, pending_.data(), pending_.size(), true, state_, scratch_, handler_,
+                                  consumed);
+    }
+    state_ = IniParser::State();
+    pending_.clear();
+    stopped_ = false;
+    return result;
+  }
+};
+
+/************************************************
+ * Conversion Functors
+ ************************************************/
+
+inline bool StrToLong(const std::string& value, long& result) {
+  char* endptr;
+  // check if decimal
+  result = std::strtol(value.c_str(), &endptr, 10);
+  if (*endptr == '\0')
+    return true;
+  // check if octal
+  result = std::strtol(value.c_str(), &endptr, 8);
+  if (*endptr == '\0')
+    return true;
+  // check if hex
+  result = std::strtol(value.c_str(), &endptr, 16);
+  if (*endptr == '\0')
+    return true;
+
+  return false;
+}
+
+inline bool StrToULong(const std::string& value, unsigned long& result) {
+  char* endptr;
+  // check if decimal
+  result = std::strtoul(value.c_str(), &endptr, 10);
+  if (*endptr == '\0')
+    return true;
+  // check if octal
+  result = std::strtoul(value.c_str(), &endptr, 8);
+  if (*endptr == '\0')
+    return true;
+  // check if hex
+  result = std::strtoul(value.c_str(), &endptr, 16);
+  if (*endptr == '\0')
+    return true;
+
+  return false;
+}
+
+template <typename T>
+struct Convert {};
+
+template <>
+struct Convert<bool> {
+  void Decode(const std::string& value, bool& result) {
+    std::string str(value);
+    std::transform(str.begin(), str.end(), str.begin(), [](const char c) { return static_cast<char>(::toupper(c)); });
+
+    if (str == "TRUE")
+      result = true;
+    else if (str == "FALSE")
+      result = false;
+    else
+      INICPP_THROW(std::invalid_argument, "field is not a bool");
+  }
+
+  void Encode(const bool value, std::string& result) { result = value ? "true" : "false"; }
+};
+
+template <>
+struct Convert<char> {
+  void Decode(const std::string& value, char& result) {
+    assert(value.size() > 0);
+    result = value[0];
+  }
+
+  void Encode(const char value, std::string& result) { result = value; }
+};
+
+template <>
+struct Convert<unsigned char> {
+  void Decode(const std::string& value, unsigned char& result) {
+    assert(value.size() > 0);
+    result = value[0];
+  }
+
+  void Encode(const unsigned char value, std::string& result) { result = value; }
+};
+
+template <>
+struct Convert<short> {
+  void Decode(const std::string& value, short& result) {
+    long tmp;
+    if (!StrToLong(value, tmp))
+      INICPP_THROW(std::invalid_argument, "field is not a short");
+    result = static_cast<short>(tmp);
+  }
+
+  void Encode(const short value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<unsigned short> {
+  void Decode(const std::string& value, unsigned short& result) {
+    unsigned long tmp;
+    if (!StrToULong(value, tmp))
+      INICPP_THROW(std::invalid_argument, "field is not an unsigned short");
+    result = static_cast<unsigned short>(tmp);
+  }
+
+  void Encode(const unsigned short value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<int> {
+  void Decode(const std::string& value, int& result) {
+    long tmp;
+    if (!StrToLong(value, tmp))
+      INICPP_THROW(std::invalid_argument, "field is not an int");
+    result = static_cast<int>(tmp);
+  }
+
+  void Encode(const int value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<unsigned int> {
+  void Decode(const std::string& value, unsigned int& result) {
+    unsigned long tmp;
+    if (!StrToULong(value, tmp))
+      INICPP_THROW(std::invalid_argument, "field is not an unsigned int");
+    result = static_cast<unsigned int>(tmp);
+  }
+
+  void Encode(const unsigned int value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<long> {
+  void Decode(const std::string& value, long& result) {
+    if (!StrToLong(value, result))
+      INICPP_THROW(std::invalid_argument, "field is not a long");
+  }
+
+  void Encode(const long value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<unsigned long> {
+  void Decode(const std::string& value, unsigned long& result) {
+    if (!StrToULong(value, result))
+      INICPP_THROW(std::invalid_argument, "field is not an unsigned long");
+  }
+
+  void Encode(const unsigned long value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<double> {
+  void Decode(const std::string& value, double& result) { result = std::stod(value); }
+
+  void Encode(const double value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<float> {
+  void Decode(const std::string& value, float& result) { result = std::stof(value); }
+
+  void Encode(const float value, std::string& result) {
+    std::stringstream ss;
+    ss << value;
+    result = ss.str();
+  }
+};
+
+template <>
+struct Convert<std::string> {
+  void Decode(const std::string& value, std::string& result) { result = value; }
+
+  void Encode(const std::string& value, std::string& result) { result = value; }
+};
+
+#ifdef __cpp_lib_string_view
+template <>
+struct Convert<std::string_view> {
+  void Decode(const std::string& value, std::string_view& result) { result = value; }
+
+  void Encode(const std::string_view value, std::string& result) { result = value; }
+};
+#else
+template <>
+struct Convert<StringView> {
+  void Decode(const std::string& value, StringView& result) { result = value; }
+
+  void Encode(const StringView value, std::string& result) { result.assign(value.data(), value.size()); }
+};
+#endif
+
+template <>
+struct Convert<const char*> {
+  void Encode(const char* const& value, std::string& result) { result = value; }
+
+  void Decode(const std::string& value, const char*& result) { result = value.c_str(); }
+};
+
+template <>
+struct Convert<char*> {
+  void Encode(const char* const& value, std::string& result) { result = value; }
+};
+
+template <size_t n>
+struct Convert<char[n]> {
+  void Encode(const char* value, std::string& result) { result = value; }
+};
+
+/** Tag of the types whose decoded value IniField caches, 0 for types it
+ * does not cache. Without exceptions a failed decode cannot be told apart
+ * from a successful one, so nothing is cached. */
+template <typename T>
+struct FieldCacheTag : std::integral_constant<unsigned char, 0> {};
+
+#if defined(__cpp_exceptions)
+template <>
+struct FieldCacheTag<bool> : std::integral_constant<unsigned char, 2> {};
+template <>
+struct FieldCacheTag<char> : std::integral_constant<unsigned char, 3> {};
+template <>
+struct FieldCacheTag<unsigned char> : std::integral_constant<unsigned char, 4> {};
+template <>
+struct FieldCacheTag<short> : std::integral_constant<unsigned char, 5> {};
+template <>
+struct FieldCacheTag<unsigned short> : std::integral_constant<unsigned char, 6> {};
+template <>
+struct FieldCacheTag<int> : std::integral_constant<unsigned char, 7> {};
+template <>
+struct FieldCacheTag<unsigned int> : std::integral_constant<unsigned char, 8> {};
+template <>
+struct FieldCacheTag<long> : std::integral_constant<unsigned char, 9> {};
+template <>
+struct FieldCacheTag<unsigned long> : std::integral_constant<unsigned char, 10> {};
+template <>
+struct FieldCacheTag<double> : std::integral_constant<unsigned char, 11> {};
+template <>
+struct FieldCacheTag<float> : std::integral_constant<unsigned char, 12> {};
+#endif
+
+template <typename Comparator, typename Container>
+class IniFileBase;
+
+template <typename Comparator, typename Container>
+class IniFieldHandle;
+
+class IniField {
+ private:
+  template <typename Comparator, typename Container>
+  friend class IniFileBase;
+
+  std::string value_;
+#ifdef INICPP_FIELD_CACHE
+  enum : std::uint32_t {
+    kCacheEmpty = 0,
+    // the cache is being filled by another reader
+    kCacheBusy = 1
+  };
+
+  // decoded value of the cached type the field was read as last, see
+  // FieldCacheTag. The low byte of the state is the tag of the type and the
+  // rest counts the writes, so a reader notices if the bits were replaced
+  // while it read them. Assignments empty the cache.
+  mutable std::atomic<std::uint64_t> cache_bits_{0};
+  mutable std::atomic<std::uint32_t> cache_state_{kCacheEmpty};
+#endif
+
+  template <typename T>
+  T Decode() const {
+    Convert<T> conv;
+    T result;
+    conv.Decode(value_, result);
+    return result;
+  }
+
+#ifdef INICPP_FIELD_CACHE
+  template <typename T>
+  T DecodeCached(std::false_type /* cached */) const {
+    return Decode<T>();
+  }
+
+  template <typename T>
+  T DecodeCached(std::true_type /* cached */) const {
+    static_assert(sizeof(T) <= sizeof(std::uint64_t), "cached type does not fit");
+    T result;
+    std::uint32_t state = cache_state_.load(std::memory_order_acquire);
+    if ((state & 0xff) == FieldCacheTag<T>::value) {
+      const std::uint64_t bits = cache_bits_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (cache_state_.load(std::memory_order_relaxed) == state) {
+        std::memcpy(&result, &bits, sizeof(T));
+        return result;
+      }
+    }
+    result = Decode<T>();
+    // replace the cached value, unless another reader is replacing it
+    if ((state & 0xff) != kCacheBusy &&
+        cache_state_.compare_exchange_strong(state, (state & ~0xffu) | kCacheBusy, std::memory_order_relaxed)) {
+      std::atomic_thread_fence(std::memory_order_release);
+      std::uint64_t bits = 0;
+      std::memcpy(&bits, &result, sizeof(T));
+      cache_bits_.store(bits, std::memory_order_relaxed);
+      cache_state_.store((state & ~0xffu) + 0x100 + FieldCacheTag<T>::value, std::memory_order_release);
+    }
+    return result;
+  }
+
+  void CopyCache(const IniField& field) {
+    const std::uint32_t state = field.cache_state_.load(std::memory_order_acquire);
+    cache_bits_.store(field.cache_bits_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    cache_state_.store((state & 0xff) == kCacheBusy ? static_cast<std::uint32_t>(kCacheEmpty) : state,
+                       std::memory_order_relaxed);
+  }
+
+  /** Empties the cache, called whenever the raw value changes. */
+  void ResetCache() { cache_state_.store(kCacheEmpty, std::memory_order_relaxed); }
+#else
+  void CopyCache(const IniField& /* field */) {}
+  void ResetCache() {}
+#endif
+
+  const std::string& Value() const { return value_; }
+
+  /** Sets a decoded value. */
+  void Assign(const StringView value) {
+    value_.assign(value.data(), value.size());
+    ResetCache();
+  }
+
+  /** Appends a continuation line of a multi-line value. */
+  void Append(const StringView line) {
+    value_.append(1, '\n').append(line.data(), line.size());
+    ResetCache();
+  }
+
+ public:
+  IniField() : value_() {}
+
+  IniField(const std::string& value) : value_(value) {}
+  IniField(const IniField& field) : value_(field.value_) { CopyCache(field); }
+  IniField(IniField&& field) noexcept : value_(std::move(field.value_)) { CopyCache(field); }
+
+  ~IniField() {}
+
+  /** Decodes the field to the given type. If INICPP_FIELD_CACHE is
+   * defined, the result of the last successful decode to bool or an
+   * arithmetic type is cached, reading the field as that type again skips
+   * the conversion. */
+  template <typename T>
+  T As() const {
+#ifdef INICPP_FIELD_CACHE
+    return DecodeCached<T>(std::integral_constant<bool, FieldCacheTag<T>::value != 0>());
+#else
+    return Decode<T>();
+#endif
+  }
+
+  template <typename T>
+  IniField& operator=(const T& value) {
+    Convert<T> conv;
+    conv.Encode(value, value_);
+    ResetCache();
+    return *this;
+  }
+
+  IniField& operator=(const IniField& field) {
+    value_ = field.value_;
+    CopyCache(field);
+    return *this;
+  }
+
+  IniField& operator=(IniField&& field) noexcept {
+    value_ = std::move(field.value_);
+    CopyCache(field);
+    return *this;
+  }
+
+  /** Fields are equal if their raw values are equal. */
+  bool operator==(const IniField& field) const { return value_ == field.value_; }
+  bool operator!=(const IniField& field) const { return !(*this == field); }
+};
+
+/** Returns the ASCII lower case of a character, all other bytes are
+ * returned unchanged. Unlike ::tolower it does not depend on the locale. */
+inline unsigned char FoldCase(const char c) {
+  static const unsigned char kTable[256] = {
+      0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,
+     16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31,
+     32,  33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,
+     48,  49,  50,  51,  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,
+     64,  97,  98,  99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111,
+    112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122,  91,  92,  93,  94,  95,
+     96,  97,  98,  99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111,
+    112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127,
+    128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143,
+    144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175,
+    176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191,
+    192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207,
+    208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223,
+    224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239,
+    240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255,
+  };
+  return kTable[static_cast<unsigned char>(c)];
+}
+
+#ifdef INICPP_HAS_SSE2
+/** Folds the ASCII upper case letters among 16 bytes to lower case. Bytes
+ * above 0x7f compare as negative and are left unchanged. */
+inline __m128i FoldCase16(const __m128i bytes) {
+  const __m128i upper =
+      _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+  return _mm_or_si128(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+/** Folds the ASCII upper case letters among the 8 bytes of a word to lower
+ * case, bytes above 0x7f are left unchanged. */
+inline std::uint64_t FoldCase8(const std::uint64_t word) {
+  const std::uint64_t kHigh = 0x8080808080808080ull;
+  const std::uint64_t low = word & ~kHigh;
+  // the high bit of a byte is set if it is at least 'A', respectively above 'Z'
+  const std::uint64_t at_least_a = low + 0x3f3f3f3f3f3f3f3full;
+  const std::uint64_t above_z = low + 0x2525252525252525ull;
+  const std::uint64_t upper = at_least_a & ~above_z & ~word & kHigh;
+  return word | (upper >> 2);
+}
+
+/** Returns the number of leading bytes two ranges of the given size have
+ * in common, ignoring ASCII case. Ranges are compared 16 bytes at a time
+ * with SSE2 and 8 bytes at a time in a general purpose register. */
+inline std::size_t MismatchInsensitive(const char* lhs, const char* rhs, const std::size_t size) {
+  std::size_t pos = 0;
+#ifdef INICPP_HAS_SSE2
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i l = FoldCase16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + pos)));
+    const __m128i r = FoldCase16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + pos)));
+    const std::uint32_t equal = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)));
+    if (equal != 0xffff)
+      return pos + CountTrailingZeros(~equal);
+  }
+#endif
+  for (; pos + 8 <= size; pos += 8) {
+    std::uint64_t l;
+    std::uint64_t r;
+    std::memcpy(&l, lhs + pos, 8);
+    std::memcpy(&r, rhs + pos, 8);
+    if (FoldCase8(l) != FoldCase8(r))
+      break;
+  }
+  while (pos < size && FoldCase(lhs[pos]) == FoldCase(rhs[pos]))
+    ++pos;
+  return pos;
+}
+
+/** Compares two strings ignoring ASCII case without allocating.
+ * @return negative, zero or positive like std::string::compare */
+inline int CompareInsensitive(const StringView lhs, const StringView rhs) {
+  const std::size_t size = std::min(lhs.size(), rhs.size());
+  const std::size_t pos = MismatchInsensitive(lhs.data(), rhs.data(), size);
+  if (pos != size)
+    return FoldCase(lhs[pos]) < FoldCase(rhs[pos]) ? -1 : 1;
+  return lhs.size() < rhs.size() ? -1 : (lhs.size() > rhs.size() ? 1 : 0);
+}
+
+/** Orders names like std::less<std::string>. The comparator is
+ * transparent, so names given as C strings or views are looked up
+ * without building a std::string. */
+struct StringLess {
+  using is_transparent = void;
+
+  bool operator()(const StringView lhs, const StringView rhs) const {
+    const std::size_t size = std::min(lhs.size(), rhs.size());
+    const int result = size == 0 ? 0 : std::memcmp(lhs.data(), rhs.data(), size);
+    return result < 0 || (result == 0 && lhs.size() < rhs.size());
+  }
+};
+
+/** Orders names ignoring ASCII case. The comparator is transparent like
+ * StringLess. */
+struct StringInsensitiveLess {
+  using is_transparent = void;
+
+  bool operator()(const StringView lhs, const StringView rhs) const { return CompareInsensitive(lhs, rhs) < 0; }
+};
+
+template <typename... Types>
+struct MakeVoid {
+  using type = void;
+};
+
+/** True if a container can look up a name given as a view without
+ * converting it to its key type. That needs a transparent comparator and,
+ * for the standard containers, C++14. */
+template <typename Map, typename = void>
+struct HasGenericLookup : std::false_type {};
+
+template <typename Map>
+struct HasGenericLookup<
+    Map, typename MakeVoid<decltype(std::declval<const Map&>().find(std::declval<StringView>()))>::type>
+    : std::true_type {};
+
+/** True for comparators that order names by the address of their pooled
+ * copy, see InternedMapContainer. */
+template <typename Compare>
+struct IsPooledOrder : std::false_type {};
+
+/** Key a name is converted to by containers that cannot look up a view.
+ * Specialized for keys that are not strings. */
+template <typename Key>
+struct LookupKey {
+  static const std::string& Make(const std::string& name) { return name; }
+};
+
+struct KeyLookup {};
+struct GenericLookup {};
+struct PooledLookup {};
+
+template <typename Map>
+using LookupKind = typename std::conditional<
+    IsPooledOrder<typename Map::key_compare>::value, PooledLookup,
+    typename std::conditional<HasGenericLookup<Map>::value, GenericLookup, KeyLookup>::type>::type;
+
+template <typename Map>
+auto FindName(Map& map, const StringView name, GenericLookup) -> decltype(map.end()) {
+  return map.find(name);
+}
+
+template <typename Map>
+auto FindName(Map& map, const StringView name, KeyLookup) -> decltype(map.end()) {
+  // the key keeps its capacity, so only lookups of longer names than
+  // before allocate
+  thread_local std::string key;
+  key.assign(name.data(), name.size());
+  return map.find(LookupKey<typename std::remove_const<Map>::type::key_type>::Make(key));
+}
+
+template <typename Map>
+auto FindName(Map& map, const StringView name, PooledLookup) -> decltype(map.end()) {
+  // a name that is not in the pool is in no container of the pool
+  using Key = typename std::remove_const<Map>::type::key_type;
+  const std::string* pooled = Key::PoolType::Get().Find(name);
+  return pooled != nullptr ? map.find(Key::Wrap(*pooled)) : map.end();
+}
+
+/** Finds the entry with the given name in a container. Containers that
+ * cannot look up a view, like std::map before C++14, are searched with a
+ * per-thread std::string that is reused between calls. Containers keyed
+ * by pooled names look the name up in the pool, which never adds it. */
+template <typename Map>
+auto FindName(Map& map, const StringView name) -> decltype(map.end()) {
+  return FindName(map, name, LookupKind<typename std::remove_const<Map>::type>());
+}
+
+template <typename Map>
+auto FindName(Map& map, const std::string& name, std::true_type /* string key */) -> decltype(map.end()) {
+  return map.find(name);
+}
+
+template <typename Map>
+auto FindName(Map& map, const std::string& name, std::false_type /* string key */) -> decltype(map.end()) {
+  return FindName(map, StringView(name));
+}
+
+/** Finds the entry with the given name, containers keyed by std::string
+ * are searched with the name itself. */
+template <typename Map>
+auto FindName(Map& map, const std::string& name) -> decltype(map.end()) {
+  return FindName(map, name, std::is_same<typename std::remove_const<Map>::type::key_type, std::string>());
+}
+
+/** Hash and equality of names that agree with a comparator, used by the
+ * hash based container policy. Specializations exist for the comparators
+ * of the library, names are hashed without allocating. */
+template <typename Comparator>
+struct KeyTraits;
+
+template <>
+struct KeyTraits<std::less<std::string>> {
+  static std::uint64_t Hash(const StringView key) { return MixHash(FastHash(key.data(), key.size())); }
+
+  static bool Equal(const StringView lhs, const StringView rhs) {
+    return lhs.size() == rhs.size() && (lhs.size() == 0 || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+  }
+};
+
+template <>
+struct KeyTraits<StringLess> : KeyTraits<std::less<std::string>> {};
+
+template <>
+struct KeyTraits<StringInsensitiveLess> {
+  /** Same as FastHash of the lower case key. */
+  static std::uint64_t Hash(const StringView key) {
+    const char* data = key.data();
+    std::size_t size = key.size();
+    std::uint64_t hash = 14695981039346656037ull ^ (static_cast<std::uint64_t>(size) * 0x9e3779b97f4a7c15ull);
+    for (; size >= 8; data += 8, size -= 8) {
+      std::uint64_t word;
+      std::memcpy(&word, data, 8);
+      hash = (hash ^ FoldCase8(word)) * 0x9e3779b97f4a7c15ull;
+      hash ^= hash >> 32;
+    }
+    char folded[8];
+    for (std::size_t i = 0; i < size; ++i)
+      folded[i] = static_cast<char>(FoldCase(data[i]));
+    return MixHash(Fnv1a(folded, size, hash));
+  }
+
+  static bool Equal(const StringView lhs, const StringView rhs) {
+    return lhs.size() == rhs.size() && MismatchInsensitive(lhs.data(), rhs.data(), lhs.size()) == lhs.size();
+  }
+};
+
+/************************************************
+ * Container Policies
+ ************************************************/
+
+/** Default container policy, sections and fields are stored in std::map. */
+struct MapContainer {
+  template <typename Key, typename Value, typename Compare>
+  using Type = std::map<Key, Value, Compare>;
+};
+
+/** Bump allocator that carves memory out of blocks that double in size.
+ * Memory is only given back when the arena is destroyed. Deallocated
+ * chunks of the first few sizes that are freed (in practice the node sizes
+ * of the containers sharing the arena) are kept on free lists and reused,
+ * so erasing and inserting does not grow the arena. No block is allocated
+ * before the first chunk, and the first block is small. Allocating and
+ * deallocating are serialized by a mutex, so containers that share the
+ * arena may be modified from different threads. */
+class Arena {
+ private:
+  struct FreeChunk {
+    FreeChunk* next;
+  };
+
+  struct FreeList {
+    std::size_t chunk_size = 0;
+    FreeChunk* head = nullptr;
+  };
+
+  static constexpr std::size_t kMinBlockSize = 256;
+  static constexpr std::size_t kMaxBlockSize = 1 << 16;
+  static constexpr std::size_t kFreeListCount = 4;
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char* cursor_ = nullptr;
+  std::size_t remaining_ = 0;
+  std::size_t next_block_size_ = kMinBlockSize;
+  FreeList free_lists_[kFreeListCount];
+  mutable std::mutex mutex_;
+
+  /** Returns the free list of chunks of the given size, claiming an unused
+   * one if there is none yet, or nullptr if all lists are taken. */
+  FreeList* FindFreeList(const std::size_t size, const bool claim) {
+    for (FreeList& list : free_lists_) {
+      if (list.chunk_size == size)
+        return &list;
+      if (list.chunk_size == 0) {
+        if (!claim)
+          return nullptr;
+        list.chunk_size = size;
+        return &list;
+      }
+    }
+    return nullptr;
+  }
+
+  static std::size_t AlignUp(const std::size_t size) {
+    const std::size_t align = alignof(std::max_align_t);
+    return (std::max(size, sizeof(FreeChunk)) + align - 1) & ~(align - 1);
+  }
+
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* Allocate(std::size_t size) {
+    size = AlignUp(size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    FreeList* list = FindFreeList(size, false);
+    if (list != nullptr && list->head != nullptr) {
+      FreeChunk* chunk = list->head;
+      list->head = chunk->next;
+      return chunk;
+    }
+
+    if (size > remaining_) {
+      const std::size_t block_size = std::max(next_block_size_, size);
+      blocks_.emplace_back(new char[block_size]);
+      cursor_ = blocks_.back().get();
+      remaining_ = block_size;
+      next_block_size_ = next_block_size_ < kMaxBlockSize / 2 ? next_block_size_ * 2 : kMaxBlockSize;
+    }
+
+    void* result = cursor_;
+    cursor_ += size;
+    remaining_ -= size;
+    return result;
+  }
+
+  void Deallocate(void* ptr, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FreeList* list = FindFreeList(AlignUp(size), true);
+    if (list == nullptr)
+      return;
+    FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+    chunk->next = list->head;
+    list->head = chunk;
+  }
+
+  /** Returns the number of blocks that were requested from the heap. */
+  std::size_t BlockCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size();
+  }
+};
+
+/** Standard allocator interface on top of a shared Arena. Copies of the
+ * allocator (including rebound ones) share the arena, a copied container
+ * gets a fresh arena of its own. */
+template <typename T>
+class ArenaAllocator {
+ private:
+  std::shared_ptr<Arena> arena_;
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() : arena_(std::make_shared<Arena>()) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(const std::size_t n) { return static_cast<T*>(arena_->Allocate(n * sizeof(T))); }
+
+  void deallocate(T* ptr, const std::size_t n) { arena_->Deallocate(ptr, n * sizeof(T)); }
+
+  ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+  const std::shared_ptr<Arena>& arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena();
+  }
+};
+
+/** Container policy that stores sections and fields in std::map, but
+ * allocates the map nodes, and only those, from an arena owned by the
+ * file. The allocator is scoped, so the file passes its arena on to every
+ * section it creates or copies. Nodes decoded one after another are laid
+ * out next to each other, and the blocks of the arena are freed with the
+ * file. Names and values are std::string, so those longer than the inline
+ * buffer are still allocated and freed one by one. A section that is
+ * created on its own has an arena of its own. The arena locks a mutex, so
+ * fields of different sections may be added or erased from different
+ * threads like with MapContainer. */
+struct ArenaMapContainer {
+  template <typename Key, typename Value, typename Compare>
+  using Type =
+      std::map<Key, Value, Compare, std::scoped_allocator_adaptor<ArenaAllocator<std::pair<const Key, Value>>>>;
+};
+
+/** Map-like container that keeps its entries sorted by key in one
+ * contiguous vector. Lookups are a binary search over adjacent entries and
+ * iteration is a linear scan, at the cost of linear time inserts and
+ * erases. Entries appended in key order are pushed back without a search.
+ * Inserting or erasing invalidates iterators, pointers and references to
+ * other entries of the same container. */
+template <typename Key, typename Value, typename Compare>
+class FlatMap {
+ public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<Key, Value>;
+  using key_compare = Compare;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+  using reverse_iterator = typename std::vector<value_type>::reverse_iterator;
+  using const_reverse_iterator = typename std::vector<value_type>::const_reverse_iterator;
+
+ private:
+  std::vector<value_type> entries_;
+  Compare compare_;
+
+  template <typename K>
+  iterator LowerBound(const K& key) {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            [this](const value_type& entry, const K& k) { return compare_(entry.first, k); });
+  }
+
+  template <typename K>
+  const_iterator LowerBound(const K& key) const {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            [this](const value_type& entry, const K& k) { return compare_(entry.first, k); });
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> TryEmplace(const Key& key, Args&&... args) {
+    if (entries_.empty() || compare_(entries_.back().first, key)) {
+      entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+      return std::make_pair(entries_.end() - 1, true);
+    }
+    iterator it = lower_bound(key);
+    if (it != entries_.end() && !compare_(key, it->first))
+      return std::make_pair(it, false);
+    it = entries_.emplace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+    return std::make_pair(it, true);
+  }
+
+  std::pair<iterator, bool> InsertValue(value_type&& value) {
+    if (entries_.empty() || compare_(entries_.back().first, value.first)) {
+      entries_.push_back(std::move(value));
+      return std::make_pair(entries_.end() - 1, true);
+    }
+    iterator it = lower_bound(value.first);
+    if (it != entries_.end() && !compare_(value.first, it->first))
+      return std::make_pair(it, false);
+    return std::make_pair(entries_.insert(it, std::move(value)), true);
+  }
+
+ public:
+  FlatMap() = default;
+
+  explicit FlatMap(const Compare& compare) : compare_(compare) {}
+
+  template <typename InputIt>
+  FlatMap(InputIt first, InputIt last, const Compare& compare = Compare()) : compare_(compare) {
+    insert(first, last);
+  }
+
+  FlatMap(std::initializer_list<value_type> values, const Compare& compare = Compare()) : compare_(compare) {
+    insert(values.begin(), values.end());
+  }
+
+  iterator begin() noexcept { return entries_.begin(); }
+  const_iterator begin() const noexcept { return entries_.begin(); }
+  const_iterator cbegin() const noexcept { return entries_.cbegin(); }
+  iterator end() noexcept { return entries_.end(); }
+  const_iterator end() const noexcept { return entries_.end(); }
+  const_iterator cend() const noexcept { return entries_.cend(); }
+  reverse_iterator rbegin() noexcept { return entries_.rbegin(); }
+  const_reverse_iterator rbegin() const noexcept { return entries_.rbegin(); }
+  reverse_iterator rend() noexcept { return entries_.rend(); }
+  const_reverse_iterator rend() const noexcept { return entries_.rend(); }
+
+  bool empty() const noexcept { return entries_.empty(); }
+  size_type size() const noexcept { return entries_.size(); }
+  size_type max_size() const noexcept { return entries_.max_size(); }
+
+  /** Reserves memory for the given number of entries. */
+  void reserve(const size_type count) { entries_.reserve(count); }
+  size_type capacity() const noexcept { return entries_.capacity(); }
+  void shrink_to_fit() { entries_.shrink_to_fit(); }
+
+  void clear() noexcept { entries_.clear(); }
+
+  key_compare key_comp() const { return compare_; }
+
+  iterator lower_bound(const Key& key) { return LowerBound(key); }
+
+  const_iterator lower_bound(const Key& key) const { return LowerBound(key); }
+
+  iterator upper_bound(const Key& key) {
+    iterator it = lower_bound(key);
+    return it != entries_.end() && !compare_(key, it->first) ? it + 1 : it;
+  }
+
+  const_iterator upper_bound(const Key& key) const {
+    const_iterator it = lower_bound(key);
+    return it != entries_.end() && !compare_(key, it->first) ? it + 1 : it;
+  }
+
+  std::pair<iterator, iterator> equal_range(const Key& key) {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  iterator find(const Key& key) {
+    iterator it = lower_bound(key);
+    return it != entries_.end() && !compare_(key, it->first) ? it : entries_.end();
+  }
+
+  const_iterator find(const Key& key) const {
+    const_iterator it = lower_bound(key);
+    return it != entries_.end() && !compare_(key, it->first) ? it : entries_.end();
+  }
+
+  /** Finds a key of another type, only if the comparator is transparent. */
+  template <typename K, typename C = Compare, typename = typename C::is_transparent>
+  iterator find(const K& key) {
+    iterator it = LowerBound(key);
+    return it != entries_.end() && !compare_(key, it->first) ? it : entries_.end();
+  }
+
+  template <typename K, typename C = Compare, typename = typename C::is_transparent>
+  const_iterator find(const K& key) const {
+    const_iterator it = LowerBound(key);
+    return it != entries_.end() && !compare_(key, it->first) ? it : entries_.end();
+  }
+
+  size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+  Value& operator[](const Key& key) { return TryEmplace(key).first->second; }
+
+  Value& operator[](Key&& key) {
+    if (entries_.empty() || compare_(entries_.back().first, key)) {
+      entries_.emplace_back(std::move(key), Value());
+      return entries_.back().second;
+    }
+    iterator it = lower_bound(key);
+    if (it == entries_.end() || compare_(key, it->first))
+      it = entries_.emplace(it, std::move(key), Value());
+    return it->second;
+  }
+
+  Value& at(const Key& key) {
+    iterator it = find(key);
+    if (it == entries_.end())
+      ThrowOutOfRange("FlatMap::at: key not found");
+    return it->second;
+  }
+
+  const Value& at(const Key& key) const {
+    const_iterator it = find(key);
+    if (it == entries_.end())
+      ThrowOutOfRange("FlatMap::at: key not found");
+    return it->second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) { return InsertValue(value_type(value)); }
+
+  std::pair<iterator, bool> insert(value_type&& value) { return InsertValue(std::move(value)); }
+
+  iterator insert(const_iterator /* hint */, const value_type& value) { return insert(value).first; }
+
+  iterator insert(const_iterator /* hint */, value_type&& value) { return insert(std::move(value)).first; }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first)
+      insert(value_type(*first));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return InsertValue(value_type(std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+    return TryEmplace(key, std::forward<Args>(args)...);
+  }
+
+  iterator erase(const_iterator pos) { return entries_.erase(pos); }
+
+  iterator erase(iterator pos) { return entries_.erase(pos); }
+
+  iterator erase(const_iterator first, const_iterator last) { return entries_.erase(first, last); }
+
+  size_type erase(const Key& key) {
+    iterator it = find(key);
+    if (it == entries_.end())
+      return 0;
+    entries_.erase(it);
+    return 1;
+  }
+
+  void swap(FlatMap& other) noexcept {
+    entries_.swap(other.entries_);
+    std::swap(compare_, other.compare_);
+  }
+
+  bool operator==(const FlatMap& other) const { return entries_ == other.entries_; }
+  bool operator!=(const FlatMap& other) const { return entries_ != other.entries_; }
+};
+
+/** Container policy that stores sections and fields in a FlatMap. Suits
+ * files that are decoded once and then mostly read: lookups and
+ * iteration touch contiguous memory and there is no per-entry node
+ * allocation. References to sections and fields are invalidated when
+ * another entry is inserted into or erased from the same container. */
+struct FlatMapContainer {
+  template <typename Key, typename Value, typename Compare>
+  using Type = FlatMap<Key, Value, Compare>;
+};
+
+/** Map-like container with an open addressing hash index in the style of
+ * Swiss tables. Entries are kept densely in one vector in insertion order.
+ * A table of one control byte per slot holds 7 bits of each entry's hash,
+ * and a group of 16 control bytes is compared at once, with SSE2 where it
+ * is available. A lookup therefore compares the full name only for slots
+ * whose hash bits match. Erasing moves the last entry into the gap, so
+ * iteration order is unspecified, unless KeepOrder is set: then erasing
+ * shifts the entries behind the gap and entries are iterated in insertion
+ * order. Inserting or erasing invalidates iterators, pointers and
+ * references to other entries of the same container. Hash and equality
+ * are taken from KeyTraits<Compare>. */
+template <typename Key, typename Value, typename Compare, bool KeepOrder = false>
+class HashMap {
+ public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<Key, Value>;
+  using key_compare = Compare;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+ private:
+  using Traits = KeyTraits<Compare>;
+
+  static constexpr std::size_t kGroupWidth = 16;
+  static constexpr std::size_t kNotFound = static_cast<std::size_t>(-1);
+  static constexpr signed char kEmpty = -128;
+  static constexpr signed char kDeleted = -2;
+
+  /** Bit masks over the 16 control bytes of a group, bit i refers to the
+   * i-th slot of the group. */
+  class Group {
+   private:
+#ifdef INICPP_HAS_SSE2
+    __m128i ctrl_;
+#else
+    const signed char* ctrl_;
+#endif
+
+   public:
+#ifdef INICPP_HAS_SSE2
+    explicit Group(const signed char* ctrl) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    std::uint32_t Match(const signed char h2) const {
+      return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+    }
+
+    /** Slots that are empty or deleted, both have the sign bit set. */
+    std::uint32_t MatchFree() const { return static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl_)); }
+#else
+    explicit Group(const signed char* ctrl) : ctrl_(ctrl) {}
+
+    std::uint32_t Match(const signed char h2) const {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < kGroupWidth; ++i)
+        mask |= static_cast<std::uint32_t>(ctrl_[i] == h2) << i;
+      return mask;
+    }
+
+    std::uint32_t MatchFree() const {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < kGroupWidth; ++i)
+        mask |= static_cast<std::uint32_t>(ctrl_[i] < 0) << i;
+      return mask;
+    }
+#endif
+
+    std::uint32_t MatchEmpty() const { return Match(kEmpty); }
+  };
+
+  std::vector<value_type> entries_;
+  // one control byte per slot: kEmpty, kDeleted or the low 7 bits of the
+  // hash of the entry the slot refers to
+  std::vector<signed char> ctrl_;
+  // index into entries_ of each full slot
+  std::vector<std::uint32_t> slots_;
+  // number of slots that can still be filled before the table grows
+  std::size_t growth_left_ = 0;
+
+  static signed char H2(const std::uint64_t hash) { return static_cast<signed char>(hash & 0x7f); }
+
+  std::size_t GroupMask() const { return ctrl_.size() / kGroupWidth - 1; }
+
+  /** Returns the slot that refers to the given key, or kNotFound. Groups
+   * are probed quadratically starting at the group selected by the high
+   * bits of the hash, a group with an empty slot ends the probe. */
+  std::size_t FindSlot(const StringView key, const std::uint64_t hash) const {
+    if (ctrl_.empty())
+      return kNotFound;
+    const std::size_t mask = GroupMask();
+    std::size_t group = static_cast<std::size_t>(hash >> 7) & mask;
+    for (std::size_t step = 1;; ++step) {
+      const std::size_t base = group * kGroupWidth;
+      const Group ctrl(ctrl_.data() + base);
+      for (std::uint32_t match = ctrl.Match(H2(hash)); match != 0; match &= match - 1) {
+        const std::size_t slot = base + CountTrailingZeros(match);
+        if (Traits::Equal(entries_[slots_[slot]].first, key))
+          return slot;
+      }
+      if (ctrl.MatchEmpty() != 0 || step > mask)
+        return kNotFound;
+      group = (group + step) & mask;
+    }
+  }
+
+  /** Returns the first empty or deleted slot on the probe sequence. */
+  std::size_t FindFreeSlot(const std::uint64_t hash) const {
+    const std::size_t mask = GroupMask();
+    std::size_t group = static_cast<std::size_t>(hash >> 7) & mask;
+    for (std::size_t step = 1;; ++step) {
+      const std::uint32_t free = Group(ctrl_.data() + group * kGroupWidth).MatchFree();
+      if (free != 0)
+        return group * kGroupWidth + CountTrailingZeros(free);
+      group = (group + step) & mask;
+    }
+  }
+
+  void SetSlot(const std::size_t slot, const std::uint64_t hash, const std::size_t index) {
+    if (ctrl_[slot] == kEmpty)
+      --growth_left_;
+    ctrl_[slot] = H2(hash);
+    slots_[slot] = static_cast<std::uint32_t>(index);
+  }
+
+  /** Rebuilds the index with room for at least the given number of
+   * entries at a load factor of at most 7/8, deleted slots are dropped. */
+  void Rehash(const std::size_t count) {
+    std::size_t capacity = kGroupWidth;
+    while (capacity / 8 * 7 < count)
+      capacity *= 2;
+    ctrl_.assign(capacity, kEmpty);
+    slots_.assign(capacity, 0);
+    growth_left_ = capacity / 8 * 7;
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+      const std::uint64_t hash = Traits::Hash(entries_[i].first);
+      SetSlot(FindFreeSlot(hash), hash, i);
+    }
+  }
+
+  /** Makes sure one more entry can be inserted without exceeding the load
+   * factor. Tables that are mostly filled with deleted slots are cleaned
+   * up in place, others double in size. */
+  void PrepareInsert() {
+    if (growth_left_ != 0)
+      return;
+    if (entries_.size() < ctrl_.size() / 2)
+      Rehash(ctrl_.size() / 8 * 7);
+    else
+      Rehash(std::max<std::size_t>(entries_.size() + 1, ctrl_.size()));
+  }
+
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> TryEmplace(K&& key, Args&&... args) {
+    const std::uint64_t hash = Traits::Hash(key);
+    const std::size_t slot = FindSlot(key, hash);
+    if (slot != kNotFound)
+      return std::make_pair(entries_.begin() + slots_[slot], false);
+    PrepareInsert();
+    entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+    SetSlot(FindFreeSlot(hash), hash, entries_.size() - 1);
+    return std::make_pair(entries_.end() - 1, true);
+  }
+
+  std::pair<iterator, bool> InsertValue(value_type&& value) {
+    const std::uint64_t hash = Traits::Hash(value.first);
+    const std::size_t slot = FindSlot(value.first, hash);
+    if (slot != kNotFound)
+      return std::make_pair(entries_.begin() + slots_[slot], false);
+    PrepareInsert();
+    entries_.push_back(std::move(value));
+    SetSlot(FindFreeSlot(hash), hash, entries_.size() - 1);
+    return std::make_pair(entries_.end() - 1, true);
+  }
+
+  /** Removes the entry a slot refers to, the last entry takes its place
+   * unless the order is kept. */
+  void EraseSlot(const std::size_t slot) {
+    const std::size_t index = slots_[slot];
+    // a slot in a group without empty slots may be on the probe sequence of
+    // other keys, it has to stay occupied
+    const std::size_t base = slot / kGroupWidth * kGroupWidth;
+    ctrl_[slot] = Group(ctrl_.data() + base).MatchEmpty() != 0 ? kEmpty : kDeleted;
+    if (ctrl_[slot] == kEmpty)
+      ++growth_left_;
+
+    if (KeepOrder) {
+      entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(index));
+      for (std::size_t i = 0; i < ctrl_.size(); ++i) {
+        if (ctrl_[i] >= 0 && slots_[i] > index)
+          --slots_[i];
+      }
+      return;
+    }
+
+    const std::size_t last = entries_.size() - 1;
+    if (index != last) {
+      const std::size_t moved = FindSlot(entries_[last].first, Traits::Hash(entries_[last].first));
+      slots_[moved] = static_cast<std::uint32_t>(index);
+      entries_[index] = std::move(entries_[last]);
+    }
+    entries_.pop_back();
+  }
+
+ public:
+  HashMap() = default;
+
+  explicit HashMap(const Compare& /* compare */) {}
+
+  template <typename InputIt>
+  HashMap(InputIt first, InputIt last, const Compare& /* compare */ = Compare()) {
+    insert(first, last);
+  }
+
+  HashMap(std::initializer_list<value_type> values, const Compare& /* compare */ = Compare()) {
+    insert(values.begin(), values.end());
+  }
+
+  iterator begin() noexcept { return entries_.begin(); }
+  const_iterator begin() const noexcept { return entries_.begin(); }
+  const_iterator cbegin() const noexcept { return entries_.cbegin(); }
+  iterator end() noexcept { return entries_.end(); }
+  const_iterator end() const noexcept { return entries_.end(); }
+  const_iterator cend() const noexcept { return entries_.cend(); }
+
+  bool empty() const noexcept { return entries_.empty(); }
+  size_type size() const noexcept { return entries_.size(); }
+  size_type max_size() const noexcept { return std::numeric_limits<std::uint32_t>::max(); }
+
+  /** Reserves memory and index slots for the given number of entries. */
+  void reserve(const size_type count) {
+    entries_.reserve(count);
+    if (count > entries_.size() + growth_left_)
+      Rehash(count);
+  }
+
+  void clear() noexcept {
+    entries_.clear();
+    ctrl_.clear();
+    slots_.clear();
+    growth_left_ = 0;
+  }
+
+  key_compare key_comp() const { return Compare(); }
+
+  iterator find(const Key& key) {
+    const std::size_t slot = FindSlot(key, Traits::Hash(key));
+    return slot == kNotFound ? entries_.end() : entries_.begin() + slots_[slot];
+  }
+
+  const_iterator find(const Key& key) const {
+    const std::size_t slot = FindSlot(key, Traits::Hash(key));
+    return slot == kNotFound ? entries_.end() : entries_.begin() + slots_[slot];
+  }
+
+  /** Finds a key of another type, only if the comparator is transparent. */
+  template <typename K, typename C = Compare, typename = typename C::is_transparent>
+  iterator find(const K& key) {
+    const std::size_t slot = FindSlot(key, Traits::Hash(key));
+    return slot == kNotFound ? entries_.end() : entries_.begin() + slots_[slot];
+  }
+
+  template <typename K, typename C = Compare, typename = typename C::is_transparent>
+  const_iterator find(const K& key) const {
+    const std::size_t slot = FindSlot(key, Traits::Hash(key));
+    return slot == kNotFound ? entries_.end() : entries_.begin() + slots_[slot];
+  }
+
+  size_type count(const Key& key) const { return FindSlot(key, Traits::Hash(key)) != kNotFound ? 1 : 0; }
+
+  Value& operator[](const Key& key) { return TryEmplace(key).first->second; }
+
+  Value& operator[](Key&& key) { return TryEmplace(std::move(key)).first->second; }
+
+  Value& at(const Key& key) {
+    iterator it = find(key);
+    if (it == entries_.end())
+      ThrowOutOfRange("HashMap::at: key not found");
+    return it->second;
+  }
+
+  const Value& at(const Key& key) const {
+    const_iterator it = find(key);
+    if (it == entries_.end())
+      ThrowOutOfRange("HashMap::at: key not found");
+    return it->second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) { return InsertValue(value_type(value)); }
+
+  std::pair<iterator, bool> insert(value_type&& value) { return InsertValue(std::move(value)); }
+
+  iterator insert(const_iterator /* hint */, const value_type& value) { return insert(value).first; }
+
+  iterator insert(const_iterator /* hint */, value_type&& value) { return insert(std::move(value)).first; }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first)
+      insert(value_type(*first));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return InsertValue(value_type(std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+    return TryEmplace(key, std::forward<Args>(args)...);
+  }
+
+  /** Erases the entry at the given position.
+   * @return iterator to the entry that took its place, which has not been
+   * visited yet if entries are erased during a forward iteration. If the
+   * order is kept, that is the entry that followed the erased one. */
+  iterator erase(const_iterator pos) {
+    const std::size_t index = static_cast<std::size_t>(pos - entries_.cbegin());
+    EraseSlot(FindSlot(pos->first, Traits::Hash(pos->first)));
+    return entries_.begin() + index;
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  size_type erase(const Key& key) {
+    const std::size_t slot = FindSlot(key, Traits::Hash(key));
+    if (slot == kNotFound)
+      return 0;
+    EraseSlot(slot);
+    return 1;
+  }
+
+  void swap(HashMap& other) noexcept {
+    entries_.swap(other.entries_);
+    ctrl_.swap(other.ctrl_);
+    slots_.swap(other.slots_);
+    std::swap(growth_left_, other.growth_left_);
+  }
+
+  /** Maps are equal if they have equal entries, in any order. */
+  bool operator==(const HashMap& other) const {
+    if (size() != other.size())
+      return false;
+    for (const value_type& entry : entries_) {
+      const_iterator it = other.find(entry.first);
+      if (it == other.end() || !(it->second == entry.second))
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const HashMap& other) const { return !(*this == other); }
+};
+
+template <typename Key, typename Value, typename Compare, bool KeepOrder>
+constexpr std::size_t HashMap<Key, Value, Compare, KeepOrder>::kGroupWidth;
+template <typename Key, typename Value, typename Compare, bool KeepOrder>
+constexpr std::size_t HashMap<Key, Value, Compare, KeepOrder>::kNotFound;
+template <typename Key, typename Value, typename Compare, bool KeepOrder>
+constexpr signed char HashMap<Key, Value, Compare, KeepOrder>::kEmpty;
+template <typename Key, typename Value, typename Compare, bool KeepOrder>
+constexpr signed char HashMap<Key, Value, Compare, KeepOrder>::kDeleted;
+
+/** Container policy that stores sections and fields in a HashMap. Looking
+ * up a name costs one hash and usually a single name comparison, but
+ * sections and fields are iterated in unspecified order. Encode sorts
+ * them first, so encoded files are the same as with the other policies.
+ * References to sections and fields are invalidated when another entry is
+ * inserted into or erased from the same container. */
+struct HashMapContainer {
+  template <typename Key, typename Value, typename Compare>
+  using Type = HashMap<Key, Value, Compare>;
+};
+
+/** Container policy that keeps sections and fields in the order they
+ * were first inserted, so decoding and encoding a file keeps its order.
+ * Entries are stored in a HashMap that keeps its order: appending and
+ * looking up a name take constant time, erasing takes linear time.
+ * References are invalidated like with HashMapContainer. */
+struct OrderedMapContainer {
+  template <typename Key, typename Value, typename Compare>
+  using Type = HashMap<Key, Value, Compare, true>;
+};
+
+/** Properties of a container policy. Policies whose containers do not
+ * iterate in the order of the comparator specialize it. */
+template <typename Container>
+struct ContainerTraits {
+  // entries are iterated in the order of the comparator
+  static constexpr bool kSorted = true;
+  // entries are encoded in iteration order even if it is not sorted
+  static constexpr bool kKeepOrder = false;
+};
+
+/** Type of the fields that the sections of a container policy store.
+ * Policies with fields of their own specialize it. */
+template <typename Container>
+struct ContainerField {
+  using type = IniField;
+};
+
+template <>
+struct ContainerTraits<HashMapContainer> {
+  static constexpr bool kSorted = false;
+  static constexpr bool kKeepOrder = false;
+};
+
+template <>
+struct ContainerTraits<OrderedMapContainer> {
+  static constexpr bool kSorted = false;
+  static constexpr bool kKeepOrder = true;
+};
+
+/** Set of strings that stores each distinct string once. The strings are
+ * owned by the pool and live as long as it, they are never removed.
+ * Interning and finding are thread safe. Finding a string that is in the
+ * pool takes no lock: the strings are indexed by an open addressing table
+ * whose slots are filled once and never cleared, and a full table is
+ * replaced by a larger copy while readers may still probe the old one. */
+class InternPool {
+ private:
+  struct Table {
+    std::size_t mask;
+    std::unique_ptr<std::atomic<const std::string*>[]> slots;
+
+    explicit Table(const std::size_t capacity)
+        : mask(capacity - 1), slots(new std::atomic<const std::string*>[capacity]) {
+      for (std::size_t i = 0; i < capacity; ++i)
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+  };
+
+  // serializes writers, readers only load table_ and its slots
+  mutable std::mutex mutex_;
+  // a deque keeps the addresses of its strings when it grows, the tables
+  // refer to them
+  std::deque<std::string> strings_;
+  // replaced tables are kept, since readers may still probe them; each is
+  // half the size of the next, so they take less memory than the last one
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::atomic<const Table*> table_;
+
+  static std::size_t HashOf(const StringView str) {
+    return static_cast<std::size_t>(KeyTraits<StringLess>::Hash(str));
+  }
+
+  /** Returns the pooled string equal to str, or nullptr if the table has
+   * none. Slots are filled with release stores, so a string is complete
+   * once its slot is seen. */
+  static const std::string* Probe(const Table& table, const StringView str, const std::size_t hash) {
+    for (std::size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+      const std::string* pooled = table.slots[i].load(std::memory_order_acquire);
+      if (pooled == nullptr || KeyTraits<StringLess>::Equal(*pooled, str))
+        return pooled;
+    }
+  }
+
+  /** Puts a string into the first free slot of its probe sequence. */
+  static void Place(Table& table, const std::string& pooled, const std::size_t hash) {
+    std::size_t i = hash & table.mask;
+    while (table.slots[i].load(std::memory_order_relaxed) != nullptr)
+      i = (i + 1) & table.mask;
+    table.slots[i].store(&pooled, std::memory_order_release);
+  }
+
+ public:
+  InternPool() : table_(nullptr) {
+    tables_.emplace_back(new Table(64));
+    table_.store(tables_.back().get(), std::memory_order_release);
+  }
+
+  InternPool(const InternPool&) = delete;
+  InternPool& operator=(const InternPool&) = delete;
+
+  /** Returns the pooled copy of a string, which is added if it is not in
+   * the pool yet. Strings that are in the pool are found without a lock.
+   * @param str string to be interned
+   * @return string equal to str, the same object for all equal strings */
+  const std::string& Intern(const StringView str) {
+    const std::size_t hash = HashOf(str);
+    const std::string* pooled = Probe(*table_.load(std::memory_order_acquire), str, hash);
+    if (pooled != nullptr)
+      return *pooled;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // another thread may have added it meanwhile
+    Table* table = tables_.back().get();
+    pooled = Probe(*table, str, hash);
+    if (pooled != nullptr)
+      return *pooled;
+
+    strings_.emplace_back(str.data(), str.size());
+    const std::string& added = strings_.back();
+    // keep the table at most half full, so probe sequences stay short
+    if (strings_.size() * 2 > table->mask + 1) {
+      tables_.emplace_back(new Table((table->mask + 1) * 2));
+      table = tables_.back().get();
+      for (const std::string& existing : strings_)
+        Place(*table, existing, HashOf(existing));
+      table_.store(table, std::memory_order_release);
+    } else {
+      Place(*table, added, hash);
+    }
+    return added;
+  }
+
+  /** Returns the pooled copy of a string without adding it. Takes no lock.
+   * @param str string to be found
+   * @return pooled string equal to str or nullptr if there is none */
+  const std::string* Find(const StringView str) const {
+    return Probe(*table_.load(std::memory_order_acquire), str, HashOf(str));
+  }
+
+  /** Returns the number of distinct strings in the pool. */
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return strings_.size();
+  }
+
+  /** Returns the pool of InternedString. It is never destroyed, so files
+   * with static storage duration can use it until the program ends. */
+  static InternPool& Global() {
+    static InternPool* pool = new InternPool();
+    return *pool;
+  }
+};
+
+/** Selects InternPool::Global() for BasicInternedString. Other pools are
+ * selected by a type with a static Get() that returns the pool. */
+struct GlobalInternPool {
+  static InternPool& Get() { return InternPool::Global(); }
+};
+
+/** Immutable string stored in the InternPool returned by Pool::Get().
+ * Equal strings share one pooled copy, so copying is a pointer copy and
+ * equality a pointer comparison. Converts to StringView, str() returns the
+ * pooled string. */
+template <typename Pool>
+class BasicInternedString {
+ private:
+  const std::string* str_;
+
+  struct WrapTag {};
+  BasicInternedString(const std::string& str, WrapTag) : str_(&str) {}
+
+ public:
+  using PoolType = Pool;
+
+  BasicInternedString() : BasicInternedString(std::string()) {}
+  BasicInternedString(const std::string& str) : str_(&Pool::Get().Intern(str)) {}
+  BasicInternedString(const char* str) : str_(&Pool::Get().Intern(str)) {}
+  explicit BasicInternedString(const StringView str) : str_(&Pool::Get().Intern(str)) {}
+
+  /** Refers to a string without interning it. Used to look up pooled
+   * strings returned by InternPool::Find(), or any string in containers
+   * that compare names by content. The string must outlive the result. */
+  static BasicInternedString Wrap(const std::string& str) { return BasicInternedString(str, WrapTag()); }
+
+  const std::string& str() const { return *str_; }
+  const char* data() const { return str_->data(); }
+  const char* c_str() const { return str_->c_str(); }
+  std::size_t size() const { return str_->size(); }
+  bool empty() const { return str_->empty(); }
+
+  operator StringView() const { return StringView(*str_); }
+
+  friend bool operator==(const BasicInternedString& lhs, const BasicInternedString& rhs) {
+    return lhs.str_ == rhs.str_;
+  }
+  friend bool operator==(const BasicInternedString& lhs, const std::string& rhs) { return *lhs.str_ == rhs; }
+  friend bool operator==(const std::string& lhs, const BasicInternedString& rhs) { return lhs == *rhs.str_; }
+  friend bool operator==(const BasicInternedString& lhs, const char* rhs) { return *lhs.str_ == rhs; }
+  friend bool operator==(const char* lhs, const BasicInternedString& rhs) { return lhs == *rhs.str_; }
+
+  template <typename T>
+  friend bool operator!=(const BasicInternedString& lhs, const T& rhs) {
+    return !(lhs == rhs);
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const BasicInternedString& str) { return os << *str.str_; }
+};
+
+using InternedString = BasicInternedString<GlobalInternPool>;
+
+template <typename Pool>
+struct LookupKey<BasicInternedString<Pool>> {
+  static BasicInternedString<Pool> Make(const std::string& name) { return BasicInternedString<Pool>::Wrap(name); }
+};
+
+/** Orders interned strings by the address of their pooled copy, so
+ * comparing two names is a pointer comparison. The order differs between
+ * runs of a program. */
+struct InternedAddressLess {
+  template <typename Pool>
+  bool operator()(const BasicInternedString<Pool>& lhs, const BasicInternedString<Pool>& rhs) const {
+    return std::less<const char*>()(lhs.data(), rhs.data());
+  }
+};
+
+template <>
+struct IsPooledOrder<InternedAddressLess> : std::true_type {};
+
+/** Comparator of the maps of InternedMapContainer. Names that are equal
+ * only if they are the same string are ordered by address, other
+ * comparators like StringInsensitiveLess order them by content. */
+template <typename Compare>
+struct InternedOrder {
+  using type = Compare;
+};
+
+template <>
+struct InternedOrder<StringLess> {
+  using type = InternedAddressLess;
+};
+
+/** Field of BasicInternedMapContainer. Decoded values are interned into
+ * the pool like names and shared between fields. The pooled string is
+ * immutable, so writing to the field first gives it a private copy.
+ * Continuation lines of multi-line values are appended to such a copy.
+ * Decoded values are not cached, see IniField. */
+template <typename Pool>
+class BasicInternedField {
+ private:
+  template <typename Comparator, typename Container>
+  friend class IniFileBase;
+
+  // pooled value, or own_ once the field was written
+  const std::string* value_;
+  std::unique_ptr<std::string> own_;
+
+  static const std::string& Empty() {
+    static const std::string empty;
+    return empty;
+  }
+
+  /** Returns the private copy of the value, made on the first write.
+   * @param keep whether the copy starts with the current value */
+  std::string& Own(const bool keep) {
+    if (!own_) {
+      own_.reset(keep ? new std::string(*value_) : new std::string());
+      value_ = own_.get();
+    }
+    return *own_;
+  }
+
+  const std::string& Value() const { return *value_; }
+
+  /** Shares the pooled copy of a decoded value. */
+  void Assign(const StringView value) {
+    value_ = &Pool::Get().Intern(value);
+    own_.reset();
+  }
+
+  /** Appends a continuation line of a multi-line value. */
+  void Append(const StringView line) { Own(true).append(1, '\n').append(line.data(), line.size()); }
+
+ public:
+  BasicInternedField() : value_(&Empty()) {}
+  BasicInternedField(const std::string& value) : value_(&Pool::Get().Intern(value)) {}
+
+  BasicInternedField(const BasicInternedField& field) : value_(field.value_) {
+    if (field.own_)
+      Own(false) = *field.own_;
+  }
+
+  BasicInternedField(BasicInternedField&& field) noexcept : value_(field.value_), own_(std::move(field.own_)) {
+    field.value_ = &Empty();
+  }
+
+  /** Decodes the field to the given type, see IniField::As. */
+  template <typename T>
+  T As() const {
+    Convert<T> conv;
+    T result;
+    conv.Decode(*value_, result);
+    return result;
+  }
+
+  /** Assigns a value, which the field stores in a private copy. */
+  template <typename T>
+  BasicInternedField& operator=(const T& value) {
+    Convert<T> conv;
+    conv.Encode(value, Own(false));
+    return *this;
+  }
+
+  BasicInternedField& operator=(const BasicInternedField& field) {
+    if (field.own_) {
+      Own(false) = *field.own_;
+    } else {
+      value_ = field.value_;
+      own_.reset();
+    }
+    return *this;
+  }
+
+  BasicInternedField& operator=(BasicInternedField&& field) noexcept {
+    if (this != &field) {
+      value_ = field.value_;
+      own_ = std::move(field.own_);
+      field.value_ = &Empty();
+    }
+    return *this;
+  }
+
+  /** Fields are equal if their values are equal. */
+  bool operator==(const BasicInternedField& field) const {
+    return value_ == field.value_ || *value_ == *field.value_;
+  }
+  bool operator!=(const BasicInternedField& field) const { return !(*this == field); }
+};
+
+/** Container policy that stores sections and fields in std::map, keyed by
+ * names interned into the pool returned by Pool::Get(). Names and decoded
+ * values repeated across files are stored once, which pays off when many
+ * similar files are kept in memory. Fields are BasicInternedField, which
+ * copy a pooled value before it is changed. Inserting a name interns it,
+ * looking one up never does. Case sensitive names are compared by
+ * address, so iteration is not sorted and a lookup is one lock-free probe
+ * of the pool followed by pointer comparisons. */
+template <typename Pool>
+struct BasicInternedMapContainer {
+  template <typename Key, typename Value, typename Compare>
+  using Type = std::map<BasicInternedString<Pool>, Value, typename InternedOrder<Compare>::type>;
+};
+
+using InternedMapContainer = BasicInternedMapContainer<GlobalInternPool>;
+
+template <typename Pool>
+struct ContainerTraits<BasicInternedMapContainer<Pool>> {
+  // false for case sensitive names, which are ordered by address
+  static constexpr bool kSorted = false;
+  static constexpr bool kKeepOrder = false;
+};
+
+template <typename Pool>
+struct ContainerField<BasicInternedMapContainer<Pool>> {
+  using type = BasicInternedField<Pool>;
+};
+
+template <typename Comparator, typename Container = MapContainer>
+class IniSectionBase
+    : public Container::template Type<std::string, typename ContainerField<Container>::type, Comparator> {
+ public:
+  /** IniField, or the field type of the container policy. */
+  using FieldType = typename ContainerField<Container>::type;
+
+ private:
+  using MapType = typename Container::template Type<std::string, FieldType, Comparator>;
+
+  friend class IniFileBase<Comparator, Container>;
+  friend class IniFieldHandle<Comparator, Container>;
+
+  // 1-based index of the byte ranges of a lazily decoded section whose
+  // fields have not been parsed yet, 0 if there is nothing to parse
+  std::size_t lazy_index_ = 0;
+  // changes whenever fields are added, removed or replaced, so that
+  // handles to a field of the section look it up again
+  std::uint64_t version_ = 0;
+
+ public:
+  IniSectionBase() {}
+  IniSectionBase(const IniSectionBase&) = default;
+  IniSectionBase(IniSectionBase&&) = default;
+  ~IniSectionBase() {}
+
+  /** Allocator-extended constructors, used by containers with a scoped
+   * allocator to hand their allocator on to the sections they create. */
+  template <typename Alloc, typename = typename std::enable_if<std::uses_allocator<MapType, Alloc>::value>::type>
+  explicit IniSectionBase(const Alloc& alloc) : MapType(alloc) {}
+
+  template <typename Alloc, typename = typename std::enable_if<std::uses_allocator<MapType, Alloc>::value>::type>
+  IniSectionBase(const IniSectionBase& other, const Alloc& alloc)
+      : MapType(other, alloc), lazy_index_(other.lazy_index_) {}
+
+  template <typename Alloc, typename = typename std::enable_if<std::uses_allocator<MapType, Alloc>::value>::type>
+  IniSectionBase(IniSectionBase&& other, const Alloc& alloc)
+      : MapType(std::move(other), alloc), lazy_index_(other.lazy_index_) {}
+
+  IniSectionBase& operator=(const IniSectionBase& other) {
+    MapType::operator=(other);
+    lazy_index_ = other.lazy_index_;
+    ++version_;
+    return *this;
+  }
+
+  IniSectionBase& operator=(IniSectionBase&& other) {
+    MapType::operator=(std::move(other));
+    lazy_index_ = other.lazy_index_;
+    ++version_;
+    ++other.version_;
+    return *this;
+  }
+
+  using MapType::operator[];
+  using MapType::at;
+  using MapType::find;
+
+  /** Returns the field with the given name, it is created if it does not
+   * exist. Finding an existing field does not allocate if the comparator
+   * is transparent.
+   * @param name name of the field
+   * @return field with the given name */
+  FieldType& operator[](const std::string& name) { return FindOrInsert(name); }
+
+  FieldType& operator[](std::string&& name) { return FindOrInsert(std::move(name)); }
+
+  FieldType& operator[](const char* name) { return (*this)[StringView(name)]; }
+
+  FieldType& operator[](const StringView name) {
+    typename MapType::iterator it = FindName(static_cast<MapType&>(*this), name);
+    return it != MapType::end() ? it->second : FindOrInsert(std::string(name));
+  }
+
+  /** Returns the field with the given name, see operator[].
+   * @throws std::out_of_range if there is no such field */
+  FieldType& at(const std::string& name) {
+    typename MapType::iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("field not found");
+    return it->second;
+  }
+
+  FieldType& at(const char* name) { return at(StringView(name)); }
+
+  FieldType& at(const StringView name) {
+    typename MapType::iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("field not found");
+    return it->second;
+  }
+
+  const FieldType& at(const std::string& name) const {
+    typename MapType::const_iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("field not found");
+    return it->second;
+  }
+
+  const FieldType& at(const char* name) const { return at(StringView(name)); }
+
+  const FieldType& at(const StringView name) const {
+    typename MapType::const_iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("field not found");
+    return it->second;
+  }
+
+  /** Finds the field with the given name, see operator[].
+   * @return iterator to the field or end() */
+  typename MapType::iterator find(const std::string& name) { return FindName(static_cast<MapType&>(*this), name); }
+
+  typename MapType::iterator find(const char* name) { return find(StringView(name)); }
+
+  typename MapType::iterator find(const StringView name) { return FindName(static_cast<MapType&>(*this), name); }
+
+  typename MapType::const_iterator find(const std::string& name) const {
+    return FindName(static_cast<const MapType&>(*this), name);
+  }
+
+  typename MapType::const_iterator find(const char* name) const { return find(StringView(name)); }
+
+  typename MapType::const_iterator find(const StringView name) const {
+    return FindName(static_cast<const MapType&>(*this), name);
+  }
+
+  /** Returns true if there is a field with the given name. */
+  bool contains(const StringView name) const { return find(name) != MapType::end(); }
+
+  /** Returns the number of fields with the given name, 0 or 1. */
+  std::size_t count(const std::string& name) const { return find(name) != MapType::end() ? 1 : 0; }
+
+  std::size_t count(const char* name) const { return count(StringView(name)); }
+
+  std::size_t count(const StringView name) const { return contains(name) ? 1 : 0; }
+
+  /** Removes fields, handles to fields of the section look them up again. */
+  std::size_t erase(const std::string& name) {
+    typename MapType::iterator it = find(name);
+    if (it == MapType::end())
+      return 0;
+    erase(it);
+    return 1;
+  }
+
+  typename MapType::iterator erase(typename MapType::iterator pos) {
+    ++version_;
+    return MapType::erase(pos);
+  }
+
+  typename MapType::iterator erase(typename MapType::const_iterator pos) {
+    ++version_;
+    return MapType::erase(pos);
+  }
+
+  template <typename Map = MapType>
+  auto erase(typename Map::const_iterator first, typename Map::const_iterator last)
+      -> decltype(std::declval<Map&>().erase(first, last)) {
+    ++version_;
+    return MapType::erase(first, last);
+  }
+
+  /** Removes all fields. */
+  void clear() {
+    ++version_;
+    MapType::clear();
+  }
+
+ private:
+  /** Finds or adds a field. Containers that move their entries may move
+   * the other fields on insertion, so handles look them up again. */
+  template <typename Name>
+  FieldType& FindOrInsert(Name&& name) {
+    const std::size_t size = MapType::size();
+    FieldType& field = MapType::operator[](std::forward<Name>(name));
+    if (MapType::size() != size)
+      ++version_;
+    return field;
+  }
+};
+
+using IniSection = IniSectionBase<StringLess>;
+using IniSectionCaseInsensitive = IniSectionBase<StringInsensitiveLess>;
+
+/************************************************
+ * Compiled Snapshots
+ ************************************************/
+
+/** Order of names in compiled snapshots. It has to agree with the
+ * comparator of the file, the specializations compare views without
+ * allocating. */
+template <typename Comparator>
+struct CompiledOrder {
+  /** identifies the order in the snapshot header, 0 for custom comparators */
+  static constexpr std::uint32_t kTag = 0;
+
+  static bool Less(const StringView lhs, const StringView rhs) {
+    return Comparator()(std::string(lhs), std::string(rhs));
+  }
+};
+
+template <>
+struct CompiledOrder<std::less<std::string>> {
+  static constexpr std::uint32_t kTag = 1;
+
+  static bool Less(const StringView lhs, const StringView rhs) {
+    const std::size_t size = lhs.size() < rhs.size() ? lhs.size() : rhs.size();
+    const int result = size == 0 ? 0 : std::memcmp(lhs.data(), rhs.data(), size);
+    return result < 0 || (result == 0 && lhs.size() < rhs.size());
+  }
+};
+
+/** Snapshots written by files with std::less and StringLess are
+ * interchangeable, the order is the same. */
+template <>
+struct CompiledOrder<StringLess> : CompiledOrder<std::less<std::string>> {};
+
+template <>
+struct CompiledOrder<StringInsensitiveLess> {
+  static constexpr std::uint32_t kTag = 2;
+
+  static bool Less(const StringView lhs, const StringView rhs) { return CompareInsensitive(lhs, rhs) < 0; }
+};
+
+/** Header of a compiled snapshot. All numbers are stored in host byte
+ * order, all offsets are relative to the start of the snapshot. The
+ * section table follows the header, the field table follows the section
+ * table and the string pool follows the field table. */
+struct CompiledHeader {
+  static constexpr std::uint32_t kVersion = 2;
+
+  char magic[8];
+  std::uint32_t version;
+  /** CompiledOrder tag of the comparator the tables are sorted with */
+  std::uint32_t order;
+  std::uint64_t file_size;
+  /** FastHash of everything after the header */
+  std::uint64_t checksum;
+  /** hash of the parse options the snapshot was decoded with */
+  std::uint64_t options;
+  /** size, modification time and FastHash of the text file the snapshot
+   * was built from, all 0 if there was none */
+  std::uint64_t source_size;
+  std::int64_t source_mtime;
+  std::uint64_t source_hash;
+  std::uint64_t section_count;
+  std::uint64_t field_count;
+  std::uint64_t strings_offset;
+  std::uint64_t strings_size;
+};
+
+/** Section table entry, sections are sorted by name. */
+struct CompiledSection {
+  std::uint64_t name_offset;
+  /** index of the first field of the section in the field table */
+  std::uint64_t first_field;
+  std::uint32_t name_size;
+  std::uint32_t field_count;
+};
+
+/** Field table entry, the fields of a section are sorted by name. */
+struct CompiledField {
+  std::uint64_t name_offset;
+  std::uint64_t value_offset;
+  std::uint32_t name_size;
+  std::uint32_t value_size;
+};
+
+/** Read-only view of a compiled snapshot written by
+ * IniFileBase::SaveCompiled. The snapshot is memory mapped and queried in
+ * place by binary search, so opening it costs a few system calls no matter
+ * how large it is, and processes that open the same snapshot share its
+ * pages. Views returned by the accessors stay valid as long as the
+ * CompiledIniBase or one of its copies exists. */
+template <typename Comparator>
+class CompiledIniBase {
+ private:
+  using Order = CompiledOrder<Comparator>;
+
+  std::shared_ptr<const MappedFile> file_;
+  CompiledHeader header_;
+  const char* data_ = nullptr;
+  // modification time of the snapshot itself
+  std::int64_t mtime_ = 0;
+
+  CompiledSection SectionEntry(const std::size_t section) const {
+    CompiledSection entry;
+    std::memcpy(&entry, data_ + sizeof(CompiledHeader) + section * sizeof(CompiledSection), sizeof(entry));
+    return entry;
+  }
+
+  CompiledField FieldEntry(const std::size_t section, const std::size_t field) const {
+    const CompiledSection section_entry = SectionEntry(section);
+    CompiledField entry;
+    const std::uint64_t index = section_entry.first_field + field;
+    if (index >= header_.field_count) {
+      std::memset(&entry, 0, sizeof(entry));
+      return entry;
+    }
+    std::memcpy(&entry,
+                data_ + sizeof(CompiledHeader) + header_.section_count * sizeof(CompiledSection) +
+                    index * sizeof(CompiledField),
+                sizeof(entry));
+    return entry;
+  }
+
+  /** Returns the given string of the pool, or an empty view if it lies
+   * outside of the pool. */
+  StringView String(const std::uint64_t offset, const std::uint32_t size) const {
+    if (offset > header_.strings_size || size > header_.strings_size - offset)
+      return StringView();
+    return StringView(data_ + header_.strings_offset + offset, size);
+  }
+
+ public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  CompiledIniBase() { std::memset(&header_, 0, sizeof(header_)); }
+
+  /** Maps the snapshot at the given path and checks its header. The body
+   * is not read, see Verify.
+   * @param file_name path to the snapshot
+   * @return false if the file is missing, not a snapshot, of another
+   * version or sorted for another comparator */
+  bool Open(const std::string& file_name) {
+    file_.reset();
+    data_ = nullptr;
+    const std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(file_name, MappedFile::kMap);
+    if (file->size() < sizeof(CompiledHeader))
+      return false;
+    CompiledHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, "INICPPC", 8) != 0 || header.version != CompiledHeader::kVersion ||
+        header.order != Order::kTag || header.file_size != file->size())
+      return false;
+
+    // the tables have to fit into the file
+    const std::uint64_t size = file->size() - sizeof(CompiledHeader);
+    if (header.section_count > size / sizeof(CompiledSection))
+      return false;
+    const std::uint64_t fields_size = size - header.section_count * sizeof(CompiledSection);
+    if (header.field_count > fields_size / sizeof(CompiledField))
+      return false;
+    const std::uint64_t tables_end = sizeof(CompiledHeader) + header.section_count * sizeof(CompiledSection) +
+                                     header.field_count * sizeof(CompiledField);
+    if (header.strings_offset < tables_end || header.strings_offset > file->size() ||
+        header.strings_size > file->size() - header.strings_offset)
+      return false;
+
+    FileStamp stamp;
+    mtime_ = StatFile(file_name, stamp) ? stamp.mtime : 0;
+    file_ = file;
+    header_ = header;
+    data_ = file->data();
+    return true;
+  }
+
+  /** @return true if a snapshot was opened successfully */
+  bool IsOpen() const { return data_ != nullptr; }
+
+  /** Checks the snapshot against its checksum, this reads the whole file.
+   * @return true if the snapshot is intact */
+  bool Verify() const {
+    if (!IsOpen())
+      return false;
+    return FastHash(data_ + sizeof(CompiledHeader), header_.file_size - sizeof(CompiledHeader)) == header_.checksum;
+  }
+
+  /** Checks whether the snapshot was built from the current contents of
+   * the given text file. Size and modification time are compared first. The
+   * file is hashed if only the time differs, so touching it does not make
+   * the snapshot stale, and if it was modified no earlier than the snapshot
+   * was written, since a later change within the same clock tick would keep
+   * its time.
+   * @param source_file path to the text file
+   * @return true if the snapshot is up to date */
+  bool IsFresh(const std::string& source_file) const {
+    FileStamp stamp;
+    if (!IsOpen() || header_.source_hash == 0 || !StatFile(source_file, stamp) || stamp.size != header_.source_size)
+      return false;
+    if (stamp.mtime != 0 && stamp.mtime == header_.source_mtime && stamp.mtime < mtime_)
+      return true;
+    MappedFile source(source_file, MappedFile::kRead);
+    return FastHash(source.data(), source.size()) == header_.source_hash;
+  }
+
+  /** @return hash of the parse options the snapshot was decoded with */
+  std::uint64_t OptionsHash() const { return header_.options; }
+
+  /** @return hash of the text file the snapshot was built from, 0 if it
+   * was saved without one */
+  std::uint64_t SourceHash() const { return header_.source_hash; }
+
+  std::size_t SectionCount() const { return static_cast<std::size_t>(header_.section_count); }
+
+  StringView SectionName(const std::size_t section) const {
+    const CompiledSection entry = SectionEntry(section);
+    return String(entry.name_offset, entry.name_size);
+  }
+
+  std::size_t FieldCount(const std::size_t section) const { return SectionEntry(section).field_count; }
+
+  StringView FieldName(const std::size_t section, const std::size_t field) const {
+    const CompiledField entry = FieldEntry(section, field);
+    return String(entry.name_offset, entry.name_size);
+  }
+
+  StringView FieldValue(const std::size_t section, const std::size_t field) const {
+    const CompiledField entry = FieldEntry(section, field);
+    return String(entry.value_offset, entry.value_size);
+  }
+
+  /** Finds the section with the given name by binary search.
+   * @return index of the section or npos */
+  std::size_t FindSection(const StringView name) const {
+    std::size_t first = 0;
+    std::size_t count = SectionCount();
+    while (count > 0) {
+      const std::size_t half = count / 2;
+      if (Order::Less(SectionName(first + half), name)) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    if (first == SectionCount() || Order::Less(name, SectionName(first)))
+      return npos;
+    return first;
+  }
+
+  /** Finds the field with the given name in the given section by binary
+   * search.
+   * @return index of the field within the section or npos */
+  std::size_t FindField(const std::size_t section, const StringView name) const {
+    const std::size_t field_count = FieldCount(section);
+    std::size_t first = 0;
+    std::size_t count = field_count;
+    while (count > 0) {
+      const std::size_t half = count / 2;
+      if (Order::Less(FieldName(section, first + half), name)) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    if (first == field_count || Order::Less(name, FieldName(section, first)))
+      return npos;
+    return first;
+  }
+
+  /** Looks up the value of a field.
+   * @param section name of the section
+   * @param field name of the field
+   * @param value receives the value if the field exists
+   * @return true if the field exists */
+  bool Get(const StringView section, const StringView field, StringView& value) const {
+    const std::size_t section_index = FindSection(section);
+    if (section_index == npos)
+      return false;
+    const std::size_t field_index = FindField(section_index, field);
+    if (field_index == npos)
+      return false;
+    value = FieldValue(section_index, field_index);
+    return true;
+  }
+};
+
+template <typename Comparator>
+constexpr std::size_t CompiledIniBase<Comparator>::npos;
+
+using CompiledIni = CompiledIniBase<StringLess>;
+using CompiledIniCaseInsensitive = CompiledIniBase<StringInsensitiveLess>;
+
+/** Outcome of IniFileBase::ReloadIfChanged. */
+enum class ReloadResult {
+  /** the file is unchanged, nothing was parsed */
+  kUnchanged,
+  /** the file changed, but it decodes to the same contents */
+  kSameContents,
+  /** the file was decoded to different contents */
+  kChanged,
+  /** no file was loaded or it cannot be read, the contents were kept */
+  kMissing
+};
+
+/** Identifies a state of the contents of a file. Values are unique within
+ * the process, and every copy, move or Next() takes a new one, so a value
+ * seen once never comes back for other contents. */
+class GenerationCounter {
+ private:
+  std::uint64_t value_;
+
+  static std::uint64_t NextValue() {
+    static std::atomic<std::uint64_t> counter(0);
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+ public:
+  GenerationCounter() : value_(NextValue()) {}
+  GenerationCounter(const GenerationCounter&) : value_(NextValue()) {}
+  GenerationCounter(GenerationCounter&& other) noexcept : value_(NextValue()) { other.Next(); }
+
+  GenerationCounter& operator=(const GenerationCounter&) {
+    Next();
+    return *this;
+  }
+
+  GenerationCounter& operator=(GenerationCounter&& other) noexcept {
+    Next();
+    other.Next();
+    return *this;
+  }
+
+  void Next() { value_ = NextValue(); }
+
+  std::uint64_t Value() const { return value_; }
+};
+
+template <typename Comparator, typename Container = MapContainer>
+class IniFileBase : public Container::template Type<std::string, IniSectionBase<Comparator, Container>, Comparator> {
+ private:
+  using SectionType = IniSectionBase<Comparator, Container>;
+  using MapType = typename Container::template Type<std::string, SectionType, Comparator>;
+  using FieldType = typename SectionType::FieldType;
+
+  /** Part of a lazily decoded buffer that belongs to one section header. */
+  struct LazyRange {
+    std::size_t begin;
+    std::size_t end;
+    int first_line;
+  };
+
+  using SourceDecoder = std::function<void(IniFileBase&, const char*, std::size_t)>;
+
+  IniParser parser_;
+  bool overwrite_duplicate_fields_ = true;
+  // buffer of a lazily decoded file, shared with its copies
+  std::shared_ptr<const char> lazy_data_;
+  // ranges of the sections that are parsed on first access, a section
+  // whose header appears several times has several ranges
+  std::vector<std::vector<LazyRange>> lazy_ranges_;
+  std::size_t lazy_pending_ = 0;
+  // file of the last Load with its stamp and content hash, and the time it
+  // was read, for ReloadIfChanged
+  std::string source_file_;
+  FileStamp source_stamp_;
+  std::uint64_t source_hash_ = 0;
+  std::time_t source_read_at_ = 0;
+  // decodes the file again with the options of the Load that read it
+  SourceDecoder source_decode_;
+  // changes whenever fields may have moved, see Resolve
+  GenerationCounter generation_;
+
+  /** Builds the sections and fields of a file from parser events. */
+  class DecodeHandler : public IniHandler {
+   private:
+    IniFileBase& file_;
+    // errors are collected here instead of thrown if set
+    DecodeResult* result_;
+    ErrorRecovery recovery_;
+    // only sections it accepts are decoded if set
+    const SectionFilter* filter_;
+    IniSectionBase<Comparator, Container>* section_ = nullptr;
+    // field that continuation lines of a multi-line value are appended to
+    FieldType* field_ = nullptr;
+
+   public:
+    explicit DecodeHandler(IniFileBase& file, DecodeResult* result = nullptr,
+                           const ErrorRecovery recovery = ErrorRecovery::kStop, const SectionFilter* filter = nullptr)
+        : file_(file), result_(result), recovery_(recovery), filter_(filter) {}
+
+    bool SelectSection(int /* line */, const StringView name) { return filter_ == nullptr || (*filter_)(name); }
+
+    bool OnSection(int /* line */, const StringView name) {
+      // keys are built from the view directly, interned keys need no
+      // intermediate string
+      section_ = &file_.Materialized(file_.FindOrInsert(typename MapType::key_type(name)));
+      field_ = nullptr;
+      return true;
+    }
+
+    bool OnField(const int line, const int column, const StringView name, const StringView value) {
+      typename SectionType::MapType::key_type key(name);
+      if (!file_.overwrite_duplicate_fields_ && section_->count(key) != 0) {
+        // a skipped duplicate must not be continued
+        field_ = nullptr;
+        ParseError error;
+        error.line = line;
+        error.column = column;
+        error.code = ParseErrorCode::kDuplicateField;
+        return OnError(error);
+      }
+      field_ = &section_->FindOrInsert(std::move(key));
+      field_->Assign(value);
+      return true;
+    }
+
+    bool OnContinuation(int /* line */, const StringView value) {
+      // extend the multi-line value in place
+      if (field_ != nullptr)
+        field_->Append(value);
+      return true;
+    }
+
+    bool OnError(const ParseError& error) {
+      if (result_ == nullptr) {
+        file_.ThrowParseError(error);
+        return false;
+      }
+      result_->errors.push_back(error);
+      return recovery_ == ErrorRecovery::kSkipBadLines;
+    }
+  };
+
+  /** Captures the name of a section header line. */
+  struct HeaderHandler : public IniHandler {
+    std::string name;
+    bool found = false;
+
+    bool OnSection(int /* line */, const StringView section_name) {
+      name.assign(section_name.data(), section_name.size());
+      found = true;
+      return true;
+    }
+  };
+
+  /** Parses the fields of the given section if it was decoded lazily. */
+  SectionType& Materialized(SectionType& section) const {
+    if (section.lazy_index_ != 0)
+      const_cast<IniFileBase*>(this)->MaterializeSection(section);
+    return section;
+  }
+
+  const SectionType& Materialized(const SectionType& section) const {
+    return Materialized(const_cast<SectionType&>(section));
+  }
+
+  /** Parses the fields of a pending section. They are parsed into a
+   * separate file first, so if they are malformed the section stays pending
+   * and every access throws again. */
+  void MaterializeSection(SectionType& section) {
+    IniFileBase part;
+    part.CopySettingsFrom(*this);
+    DecodeHandler handler(part);
+    for (const LazyRange& range : lazy_ranges_[section.lazy_index_ - 1])
+      parser_.Parse(lazy_data_.get() + range.begin, range.end - range.begin, handler, range.first_line);
+    DropPending(section);
+    // every range starts with the header of the section
+    if (!part.empty())
+      section = std::move(part.MapType::begin()->second);
+  }
+
+  /** Releases the byte ranges of a section that was not decoded yet, the
+   * buffer is released with the last pending section. */
+  void DropPending(SectionType& section) {
+    if (section.lazy_index_ == 0)
+      return;
+    std::vector<LazyRange>().swap(lazy_ranges_[section.lazy_index_ - 1]);
+    section.lazy_index_ = 0;
+    if (--lazy_pending_ == 0) {
+      lazy_data_.reset();
+      lazy_ranges_.clear();
+    }
+  }
+
+  void MaterializeAll() const {
+    if (lazy_pending_ == 0)
+      return;
+    MapType& sections = const_cast<IniFileBase&>(*this);
+    for (auto& pair : sections)
+      Materialized(pair.second);
+  }
+
+  /** Decodes the given buffer lazily: the section headers are located by a
+   * fast scan over the line starts, the fields are parsed on first access.
+   * Lines in front of the first header are decoded right away. If a header
+   * is malformed the buffer is decoded eagerly to report the error. */
+  void IndexSections(const std::shared_ptr<const char>& data, const std::size_t size) {
+    this->clear();
+    const char* const begin = data.get();
+    const char* const end = begin + size;
+    // a line starting with '[' might be a comment or an escaped prefix
+    if (parser_.CommentMatcher().MayStart('[')) {
+      Decode(begin, size);
+      return;
+    }
+
+    const char* preamble_end = end;
+    LazyRange* current = nullptr;
+    HeaderHandler header;
+    int line_no = 1;
+    for (const char* pos = begin; pos != end; ++line_no) {
+      const char* line_end = static_cast<const char*>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+      if (line_end == nullptr)
+        line_end = end;
+      const char* first = pos;
+      while (first != line_end && IsWhitespace(*first))
+        ++first;
+
+      if (first != line_end && *first == '[') {
+        header.found = false;
+        if (!parser_.Parse(pos, static_cast<std::size_t>(line_end - pos), header)) {
+          Decode(begin, size);
+          return;
+        }
+        if (header.found) {
+          const std::size_t offset = static_cast<std::size_t>(pos - begin);
+          if (current != nullptr)
+            current->end = offset;
+          else
+            preamble_end = pos;
+          SectionType& section = MapType::operator[](header.name);
+          if (section.lazy_index_ == 0) {
+            lazy_ranges_.emplace_back();
+            section.lazy_index_ = lazy_ranges_.size();
+          }
+          std::vector<LazyRange>& ranges = lazy_ranges_[section.lazy_index_ - 1];
+          LazyRange range;
+          range.begin = offset;
+          range.end = size;
+          range.first_line = line_no;
+          ranges.push_back(range);
+          current = &ranges.back();
+        }
+      }
+      pos = line_end == end ? end : line_end + 1;
+    }
+
+    lazy_pending_ = lazy_ranges_.size();
+    if (lazy_pending_ != 0)
+      lazy_data_ = data;
+    DecodeLines(begin, static_cast<std::size_t>(preamble_end - begin));
+  }
+
+  /** Returns a filter that accepts the given section names. */
+  static SectionFilter SelectSections(const std::vector<std::string>& sections) {
+    const std::shared_ptr<const std::set<std::string, Comparator>> names =
+        std::make_shared<const std::set<std::string, Comparator>>(sections.begin(), sections.end());
+    return [names](const StringView name) { return FindName(*names, name) != names->end(); };
+  }
+
+  /** Finds or adds a section. Containers that move their entries may
+   * move the other sections on insertion, so handles look them up again. */
+  template <typename Name>
+  SectionType& FindOrInsert(Name&& name) {
+    const std::size_t size = MapType::size();
+    SectionType& section = MapType::operator[](std::forward<Name>(name));
+    if (MapType::size() != size)
+      generation_.Next();
+    return section;
+  }
+
+  /** Loads the file at the given path, reading or mapping it with the
+   * given mode, decodes it with the given decoder and records both for
+   * ReloadIfChanged. */
+  void LoadFile(const std::string& file_name, const MappedFile::Mode mode, SourceDecoder decode) {
+    FileStamp stamp;
+    const bool exists = StatFile(file_name, stamp);
+    MappedFile file(file_name, mode);
+    decode(*this, file.data(), file.size());
+    if (exists)
+      RememberSource(file_name, stamp, FastHash(file.data(), file.size()), std::move(decode));
+  }
+
+  /** Records the given file as source for ReloadIfChanged. The stamp has
+   * to be taken before the file is read, so a change while reading is
+   * detected on the next reload. */
+  void RememberSource(const std::string& file_name, const FileStamp& stamp, const std::uint64_t hash,
+                      SourceDecoder decode) {
+    source_file_ = file_name;
+    source_stamp_ = stamp;
+    source_hash_ = hash;
+    source_read_at_ = std::time(nullptr);
+    source_decode_ = std::move(decode);
+  }
+
+  static void DecodeAll(IniFileBase& inif, const char* data, const std::size_t size) { inif.Decode(data, size); }
+
+  /** Returns true if this file has the same sections and fields as the
+   * given one. */
+  bool ContentEquals(const IniFileBase& other) const {
+    if (this->size() != other.size())
+      return false;
+    for (const auto& section_pair : *this) {
+      const auto other_section = other.find(section_pair.first);
+      if (other_section == other.end() || other_section->second.size() != section_pair.second.size())
+        return false;
+      for (const auto& field_pair : section_pair.second) {
+        const auto other_field = other_section->second.find(field_pair.first);
+        if (other_field == other_section->second.end() || other_field->second != field_pair.second)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  /** Hashes the options that affect the result of decoding, a compiled
+   * snapshot is only used by files with the same options. */
+  std::uint64_t OptionsHash() const {
+    const char flags[4] = {parser_.FieldSep(), parser_.EscapeChar(), parser_.MultiLineValues() ? '1' : '0',
+                           overwrite_duplicate_fields_ ? '1' : '0'};
+    std::uint64_t hash = Fnv1a(flags, sizeof(flags));
+    for (const std::string& prefix : parser_.CommentPrefixes()) {
+      hash = Fnv1a(prefix.data(), prefix.size(), hash);
+      hash = Fnv1a("", 1, hash);
+    }
+    return hash;
+  }
+
+  /** Throws the given parse error as std::logic_error. */
+  void ThrowParseError(const ParseError& error) const {
+    INICPP_THROW(std::logic_error, DescribeParseError(error, parser_).c_str());
+  }
+
+  void WriteEscaped(std::ostream& os, const StringView str) const {
+    parser_.Escape(str, [&os](const char* data, const std::size_t size) {
+      os.write(data, static_cast<std::streamsize>(size));
+    });
+  }
+
+  /** Returns pointers to the entries of the given container in the order
+   * of the comparator. */
+  template <typename Map>
+  static std::vector<const typename Map::value_type*> SortedEntries(const Map& map) {
+    std::vector<const typename Map::value_type*> entries;
+    entries.reserve(map.size());
+    for (const auto& entry : map)
+      entries.push_back(&entry);
+    const Comparator less = Comparator();
+    std::sort(entries.begin(), entries.end(),
+              [&less](const typename Map::value_type* lhs, const typename Map::value_type* rhs) {
+                return less(lhs->first, rhs->first);
+              });
+    return entries;
+  }
+
+  void EncodeSection(std::ostream& os, const StringView name, const SectionType& section) const {
+    os.put('[');
+    WriteEscaped(os, name);
+    os.put(']');
+    os.put('\n');
+
+    // iterate through all fields in the section
+    if (ContainerTraits<Container>::kSorted || ContainerTraits<Container>::kKeepOrder) {
+      for (const auto& sec_pair : section)
+        EncodeField(os, sec_pair.first, sec_pair.second);
+    } else {
+      for (const auto* sec_pair : SortedEntries(section))
+        EncodeField(os, sec_pair->first, sec_pair->second);
+    }
+
+    // Add a newline after each section
+    os.put('\n');
+  }
+
+  void EncodeField(std::ostream& os, const StringView name, const FieldType& field) const {
+    WriteEscaped(os, name);
+    os.put(parser_.FieldSep());
+    WriteEscaped(os, field.Value());
+    os.put('\n');
+  }
+
+  /** Decodes the given lines and adds them to this file without clearing it.
+   * Line numbers in error messages are relative to data. */
+  void DecodeLines(const char* data, const std::size_t size) {
+    DecodeHandler handler(*this);
+    parser_.Parse(data, size, handler);
+  }
+
+  /** Copies all parser settings, but not the contents, of the given file. */
+  void CopySettingsFrom(const IniFileBase& other) {
+    parser_ = other.parser_;
+    overwrite_duplicate_fields_ = other.overwrite_duplicate_fields_;
+  }
+
+  /** Returns the positions at which the buffer can be split into at most
+   * chunk_count parts that can be decoded independently. Every part but the
+   * first starts with a line that opens a section, which also ends any
+   * multi-line value. The first position is always data. */
+  std::vector<const char*> FindChunkStarts(const char* data, const std::size_t size,
+                                           const std::size_t chunk_count) const {
+    std::vector<const char*> starts(1, data);
+    // a line starting with '[' might be a comment and then does not end
+    // a multi-line value
+    if (parser_.CommentMatcher().MayStart('['))
+      return starts;
+
+    const char* const end = data + size;
+    for (std::size_t i = 1; i < chunk_count; ++i) {
+      const char* pos = std::max(data + size / chunk_count * i, starts.back());
+      // advance to the next line that starts with '['
+      while (pos != end) {
+        pos = static_cast<const char*>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+        if (pos == nullptr) {
+          pos = end;
+          break;
+        }
+        ++pos;
+        if (pos != end && *pos == '[')
+          break;
+      }
+      if (pos == end)
+        break;
+      starts.push_back(pos);
+    }
+    return starts;
+  }
+
+  /** Moves the sections of the given file into this one, fields of
+   * sections that already exist are overwritten. Returns false if a
+   * duplicate field was found and overwriting duplicates is not allowed. */
+  bool MergeFrom(IniFileBase& other) {
+    for (auto& other_pair : other) {
+      IniSectionBase<Comparator, Container>& section = (*this)[other_pair.first];
+      if (section.empty()) {
+        section.swap(other_pair.second);
+        continue;
+      }
+      for (auto& field_pair : other_pair.second) {
+        if (!overwrite_duplicate_fields_ && section.count(field_pair.first) != 0)
+          return false;
+        section[field_pair.first] = std::move(field_pair.second);
+      }
+    }
+    return true;
+  }
 
  public:
-  IniField() : value_() {}
+  IniFileBase() = default;
 
-  IniField(const std::string& value) : value_(value) {}
-  IniField(const IniField& field) : value_(field.value_) {}
+  IniFileBase(const char field_sep, const char comment)
+      : parser_(field_sep, std::vector<std::string>(1, std::string(1, comment))) {}
 
-  ~IniField() {}
+  IniFileBase(const std::string& filename) { Load(filename); }
+
+  IniFileBase(std::istream& is) { Decode(is); }
+
+  IniFileBase(const char field_sep, const std::vector<std::string>& comment_prefixes)
+      : parser_(field_sep, comment_prefixes) {}
+
+  IniFileBase(const std::string& filename, const char field_sep, const std::vector<std::string>& comment_prefixes)
+      : parser_(field_sep, comment_prefixes) {
+    Load(filename);
+  }
+
+  IniFileBase(std::istream& is, const char field_sep, const std::vector<std::string>& comment_prefixes)
+      : parser_(field_sep, comment_prefixes) {
+    Decode(is);
+  }
+
+  ~IniFileBase() {}
+
+  /** Returns the section with the given name, it is created if it does not
+   * exist. Fields of a lazily decoded section are parsed first.
+   * @param name name of the section
+   * @return section with the given name */
+  SectionType& operator[](const std::string& name) { return Materialized(FindOrInsert(name)); }
+
+  SectionType& operator[](std::string&& name) { return Materialized(FindOrInsert(std::move(name))); }
+
+  /** Finding an existing section by a C string or a view does not allocate
+   * if the comparator is transparent. */
+  SectionType& operator[](const char* name) { return (*this)[StringView(name)]; }
+
+  SectionType& operator[](const StringView name) {
+    typename MapType::iterator it = FindName(static_cast<MapType&>(*this), name);
+    return Materialized(it != MapType::end() ? it->second : FindOrInsert(std::string(name)));
+  }
+
+  /** Returns the section with the given name, see operator[].
+   * @throws std::out_of_range if there is no such section */
+  SectionType& at(const std::string& name) {
+    typename MapType::iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("section not found");
+    return it->second;
+  }
+
+  const SectionType& at(const std::string& name) const {
+    typename MapType::const_iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("section not found");
+    return it->second;
+  }
+
+  SectionType& at(const char* name) { return at(StringView(name)); }
+
+  SectionType& at(const StringView name) {
+    typename MapType::iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("section not found");
+    return it->second;
+  }
+
+  const SectionType& at(const char* name) const { return at(StringView(name)); }
+
+  const SectionType& at(const StringView name) const {
+    typename MapType::const_iterator it = find(name);
+    if (it == MapType::end())
+      ThrowOutOfRange("section not found");
+    return it->second;
+  }
+
+  /** Finds the section with the given name, see operator[].
+   * @return iterator to the section or end() */
+  typename MapType::iterator find(const std::string& name) {
+    typename MapType::iterator it = FindName(static_cast<MapType&>(*this), name);
+    if (it != MapType::end())
+      Materialized(it->second);
+    return it;
+  }
+
+  typename MapType::const_iterator find(const std::string& name) const {
+    typename MapType::const_iterator it = FindName(static_cast<const MapType&>(*this), name);
+    if (it != MapType::end())
+      Materialized(it->second);
+    return it;
+  }
+
+  typename MapType::iterator find(const char* name) { return find(StringView(name)); }
+
+  typename MapType::iterator find(const StringView name) {
+    typename MapType::iterator it = FindName(static_cast<MapType&>(*this), name);
+    if (it != MapType::end())
+      Materialized(it->second);
+    return it;
+  }
+
+  typename MapType::const_iterator find(const char* name) const { return find(StringView(name)); }
+
+  typename MapType::const_iterator find(const StringView name) const {
+    typename MapType::const_iterator it = FindName(static_cast<const MapType&>(*this), name);
+    if (it != MapType::end())
+      Materialized(it->second);
+    return it;
+  }
+
+  /** Returns true if there is a section with the given name. Lazily
+   * decoded sections are not parsed. */
+  bool contains(const StringView name) const {
+    return FindName(static_cast<const MapType&>(*this), name) != MapType::end();
+  }
+
+  /** Returns the number of sections with the given name, 0 or 1. Lazily
+   * decoded sections are not parsed. */
+  std::size_t count(const std::string& name) const {
+    return FindName(static_cast<const MapType&>(*this), name) != MapType::end() ? 1 : 0;
+  }
+
+  std::size_t count(const char* name) const { return count(StringView(name)); }
+
+  std::size_t count(const StringView name) const { return contains(name) ? 1 : 0; }
+
+  /** Iterators over all sections, lazily decoded sections are parsed
+   * before the iteration starts. */
+  typename MapType::iterator begin() {
+    MaterializeAll();
+    return MapType::begin();
+  }
+
+  typename MapType::const_iterator begin() const {
+    MaterializeAll();
+    return MapType::begin();
+  }
+
+  typename MapType::const_iterator cbegin() const { return begin(); }
+
+  template <typename Map = MapType>
+  auto rbegin() -> decltype(std::declval<Map&>().rbegin()) {
+    MaterializeAll();
+    return MapType::rbegin();
+  }
+
+  template <typename Map = MapType>
+  auto rbegin() const -> decltype(std::declval<const Map&>().rbegin()) {
+    MaterializeAll();
+    return MapType::rbegin();
+  }
+
+  template <typename Map = MapType>
+  auto crbegin() const -> decltype(std::declval<const Map&>().rbegin()) {
+    return rbegin();
+  }
+
+  /** Bounds of sections by name, lazily decoded sections are parsed first
+   * since the result can be iterated. */
+  template <typename Key, typename Map = MapType>
+  auto lower_bound(const Key& name) -> decltype(std::declval<Map&>().lower_bound(name)) {
+    MaterializeAll();
+    return MapType::lower_bound(name);
+  }
+
+  template <typename Key, typename Map = MapType>
+  auto lower_bound(const Key& name) const -> decltype(std::declval<const Map&>().lower_bound(name)) {
+    MaterializeAll();
+    return MapType::lower_bound(name);
+  }
+
+  template <typename Key, typename Map = MapType>
+  auto upper_bound(const Key& name) -> decltype(std::declval<Map&>().upper_bound(name)) {
+    MaterializeAll();
+    return MapType::upper_bound(name);
+  }
+
+  template <typename Key, typename Map = MapType>
+  auto upper_bound(const Key& name) const -> decltype(std::declval<const Map&>().upper_bound(name)) {
+    MaterializeAll();
+    return MapType::upper_bound(name);
+  }
+
+  template <typename Key, typename Map = MapType>
+  auto equal_range(const Key& name) -> decltype(std::declval<Map&>().equal_range(name)) {
+    MaterializeAll();
+    return MapType::equal_range(name);
+  }
+
+  template <typename Key, typename Map = MapType>
+  auto equal_range(const Key& name) const -> decltype(std::declval<const Map&>().equal_range(name)) {
+    MaterializeAll();
+    return MapType::equal_range(name);
+  }
+
+  /** Removes sections. Erasing a section that was not decoded yet drops
+   * its byte ranges of the lazily decoded buffer. */
+  std::size_t erase(const std::string& name) {
+    typename MapType::iterator it = FindName(static_cast<MapType&>(*this), StringView(name));
+    if (it == MapType::end())
+      return 0;
+    erase(it);
+    return 1;
+  }
+
+  typename MapType::iterator erase(typename MapType::iterator pos) {
+    DropPending(pos->second);
+    generation_.Next();
+    return MapType::erase(pos);
+  }
+
+  typename MapType::iterator erase(typename MapType::const_iterator pos) {
+    DropPending(const_cast<SectionType&>(pos->second));
+    generation_.Next();
+    return MapType::erase(pos);
+  }
+
+  template <typename Map = MapType>
+  auto erase(typename Map::const_iterator first, typename Map::const_iterator last)
+      -> decltype(std::declval<Map&>().erase(first, last)) {
+    for (typename MapType::const_iterator it = first; it != last; ++it)
+      DropPending(const_cast<SectionType&>(it->second));
+    generation_.Next();
+    return MapType::erase(first, last);
+  }
+
+  /** Files are equal if they have equal sections and fields, lazily
+   * decoded sections are parsed first. */
+  friend bool operator==(const IniFileBase& lhs, const IniFileBase& rhs) { return lhs.ContentEquals(rhs); }
+
+  friend bool operator!=(const IniFileBase& lhs, const IniFileBase& rhs) { return !lhs.ContentEquals(rhs); }
+
+  /** Removes all sections, including the ones not decoded yet, and forgets
+   * the file of the last Load. */
+  void clear() {
+    MapType::clear();
+    lazy_data_.reset();
+    lazy_ranges_.clear();
+    lazy_pending_ = 0;
+    source_file_.clear();
+    source_decode_ = nullptr;
+    generation_.Next();
+  }
+
+  /** Resolves a section and field name once into a handle. Reading through
+   * the handle skips both lookups until the generation of the file
+   * changes, then the names are resolved again.
+   * @param section name of the section
+   * @param name name of the field
+   * @return handle to the field, which need not exist yet */
+  IniFieldHandle<Comparator, Container> Resolve(const std::string& section, const std::string& name) const {
+    return IniFieldHandle<Comparator, Container>(*this, section, name);
+  }
+
+  /** Returns the generation of the contents. It changes whenever the file
+   * is decoded, loaded, reloaded, cleared, copied or moved, when sections
+   * are added through operator[] or erased, and on InvalidateHandles().
+   * Fields added or erased through the section are tracked by the
+   * section. */
+  std::uint64_t Generation() const { return generation_.Value(); }
+
+  /** Makes all handles resolve their names again. Call it after inserting
+   * sections or fields through the map interface (insert, emplace, swap)
+   * with a container that moves its entries (FlatMapContainer,
+   * HashMapContainer, OrderedMapContainer). */
+  void InvalidateHandles() { generation_.Next(); }
+
+  /** Sets the separator character for fields in the INI file.
+   * @param sep separator character to be used. */
+  void SetFieldSep(const char sep) { parser_.SetFieldSep(sep); }
+
+  /** Sets the character that should be interpreted as the start of comments.
+   * Default is '#'.
+   * @param comment comment character to be used. */
+  void SetCommentChar(const char comment) { SetCommentPrefixes({std::string(1, comment)}); }
+
+  /** Sets the list of strings that should be interpreted as the start of comments.
+   * Default is [ "#" ].
+   * @param comment_prefixes vector of comment prefix strings to be used. */
+  void SetCommentPrefixes(const std::vector<std::string>& comment_prefixes) {
+    parser_.SetCommentPrefixes(comment_prefixes);
+  }
+
+  /** Sets the character that should be used to escape comment prefixes.
+   * Default is '\'.
+   * @param esc escape character to be used. */
+  void SetEscapeChar(const char esc) { parser_.SetEscapeChar(esc); }
+
+  /** Sets whether or not to parse multi-line field values.
+   * Default is false.
+   * @param enable enable or disable? */
+  void SetMultiLineValues(bool enable) { parser_.SetMultiLineValues(enable); }
+
+  /** Sets whether or not overwriting duplicate fields is allowed.
+   * If overwriting duplicate fields is not allowed,
+   * an exception is thrown when a duplicate field is found inside a section.
+   * Default is true.
+   * @param allowed Is overwriting duplicate fields allowed or not? */
+  void AllowOverwriteDuplicateFields(bool allowed) { overwrite_duplicate_fields_ = allowed; }
+
+  /** Returns the parser holding the options of this file. It can be used to
+   * scan input with the same grammar without building a file.
+   * @return parser used by Decode. */
+  const IniParser& Parser() const { return parser_; }
+
+  /** Tries to decode an ini file from the given character buffer.
+   * Lines are processed as views into the buffer, so only section names,
+   * field names and values are copied. Lines containing a comment prefix
+   * are copied once into a scratch buffer to strip the comment.
+   * @param data pointer to the first character of the buffer
+   * @param size number of characters in the buffer */
+  void Decode(const char* data, const std::size_t size) {
+    this->clear();
+    DecodeLines(data, size);
+  }
+
+  /** Decodes only the sections of an ini file that the given filter
+   * selects. The lines of other sections are passed over by looking only at
+   * their first non-whitespace character, so they are neither split, trimmed
+   * nor stored, and errors in them are not reported.
+   * @param data pointer to the first character of the buffer
+   * @param size number of characters in the buffer
+   * @param select returns true for the names of sections to decode */
+  void Decode(const char* data, const std::size_t size, const SectionFilter& select) {
+    this->clear();
+    DecodeHandler handler(*this, nullptr, ErrorRecovery::kStop, &select);
+    parser_.Parse(data, size, handler);
+  }
+
+  /** Decodes only the selected sections of the given string, see
+   * Decode(const char*, std::size_t, const SectionFilter&). */
+  void Decode(const std::string& content, const SectionFilter& select) {
+    Decode(content.data(), content.size(), select);
+  }
+
+  /** Decodes only the sections with the given names from the given string,
+   * see Decode(const char*, std::size_t, const SectionFilter&). */
+  void Decode(const std::string& content, const std::vector<std::string>& sections) {
+    Decode(content.data(), content.size(), SelectSections(sections));
+  }
+
+  /** Decodes an ini file from input that arrives in chunks, e.g. from a
+   * non-blocking socket. The file is cleared when the decoder is created and
+   * filled as lines are completed. Errors are thrown from Feed or Finish
+   * like from Decode.
+   *
+   *   ini::IniFile::Decoder decoder(inif);
+   *   while (... read chunk ...)
+   *     decoder.Feed(chunk, n);
+   *   decoder.Finish(); */
+  class Decoder {
+   private:
+    DecodeHandler handler_;
+    IniFeedParser<DecodeHandler> parser_;
+
+   public:
+    /** @param file file to decode into, it has to outlive the decoder */
+    explicit Decoder(IniFileBase& file) : handler_(file), parser_(file.parser_, handler_) { file.clear(); }
+
+    /** The parser refers to the handler of this decoder, a copy would feed
+     * the handler of the original. */
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+
+    /** Decodes all lines that are completed by the given chunk. */
+    void Feed(const char* data, const std::size_t size) { parser_.Feed(data, size); }
+
+    /** Decodes the last line if it did not end with '\n'. */
+    void Finish() { parser_.Finish(); }
+  };
+
+  /** Tries to decode an ini file from the given character buffer without
+   * throwing. Errors are returned as line, column and code, no message is
+   * formatted. When decoding stops at an error the file keeps the lines
+   * before it.
+   * @param data pointer to the first character of the buffer
+   * @param size number of characters in the buffer
+   * @param recovery whether to stop at the first error or skip bad lines
+   * @return errors that were found */
+  DecodeResult TryDecode(const char* data, const std::size_t size,
+                         const ErrorRecovery recovery = ErrorRecovery::kStop) {
+    this->clear();
+    DecodeResult result;
+    DecodeHandler handler(*this, &result, recovery);
+    parser_.Parse(data, size, handler);
+    return result;
+  }
+
+  /** Tries to decode an ini file from the given string without throwing,
+   * see TryDecode(const char*, std::size_t, ErrorRecovery). */
+  DecodeResult TryDecode(const std::string& content, const ErrorRecovery recovery = ErrorRecovery::kStop) {
+    return TryDecode(content.data(), content.size(), recovery);
+  }
+
+  /** Tries to load and decode an ini file without throwing, see
+   * TryDecode(const char*, std::size_t, ErrorRecovery). A file that cannot
+   * be opened is decoded as empty. */
+  DecodeResult TryLoad(const std::string& file_name, const ErrorRecovery recovery = ErrorRecovery::kStop) {
+    MappedFile file(file_name);
+    return TryDecode(file.data(), file.size(), recovery);
+  }
+
+  /** Decodes an ini file from the given character buffer on several threads.
+   * The buffer is split in front of lines that start with '[', every part
+   * is decoded into a separate file on its own thread and the parts are
+   * merged in order, so later sections and fields win as in Decode. If any
+   * part fails, the buffer is decoded again sequentially to report the
+   * error with its exact line number.
+   * @param data pointer to the first character of the buffer
+   * @param size number of characters in the buffer
+   * @param thread_count number of threads to use, 0 picks one per core but
+   * at most one per MiB of input */
+  void DecodeParallel(const char* data, const std::size_t size, unsigned thread_count = 0) {
+    if (thread_count == 0) {
+      const std::size_t per_size = size / (1 << 20) + 1;
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+      if (per_size < thread_count)
+        thread_count = static_cast<unsigned>(per_size);
+    }
+
+    std::vector<const char*> starts = FindChunkStarts(data, size, thread_count);
+    if (starts.size() == 1) {
+      Decode(data, size);
+      return;
+    }
+    starts.push_back(data + size);
+
+    const std::size_t chunk_count = starts.size() - 1;
+    std::vector<IniFileBase> parts(chunk_count);
+    std::vector<char> failed(chunk_count, 0);
+    for (IniFileBase& part : parts)
+      part.CopySettingsFrom(*this);
+
+    auto decode_chunk = [&](const std::size_t i) {
+#if defined(__cpp_exceptions)
+      try {
+        parts[i].DecodeLines(starts[i], static_cast<std::size_t>(starts[i + 1] - starts[i]));
+      } catch (...) {
+        failed[i] = 1;
+      }
+#else
+      parts[i].DecodeLines(starts[i], static_cast<std::size_t>(starts[i + 1] - starts[i]));
+#endif
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunk_count - 1);
+    for (std::size_t i = 1; i < chunk_count; ++i)
+      workers.emplace_back(decode_chunk, i);
+    decode_chunk(0);
+    for (std::thread& worker : workers)
+      worker.join();
+
+    this->clear();
+    bool ok = std::find(failed.begin(), failed.end(), 1) == failed.end();
+    for (std::size_t i = 0; ok && i < chunk_count; ++i)
+      ok = MergeFrom(parts[i]);
+    if (!ok)
+      Decode(data, size);
+  }
+
+  /** Decodes an ini file from the given string on several threads.
+   * @param content string to be decoded
+   * @param thread_count number of threads to use, 0 picks automatically */
+  void DecodeParallel(const std::string& content, const unsigned thread_count = 0) {
+    DecodeParallel(content.data(), content.size(), thread_count);
+  }
+
+  /** Tries to decode an ini file from the given input stream.
+   * @param is input stream from which data should be read. */
+  void Decode(std::istream& is) {
+    std::string content;
+    if (is.good()) {
+      std::ostringstream ss;
+      ss << is.rdbuf();
+      content = ss.str();
+    }
+    Decode(content.data(), content.size());
+  }
+
+  /** Tries to decode an ini file from the given input string.
+   * @param content string to be decoded. */
+  void Decode(const std::string& content) { Decode(content.data(), content.size()); }
+
+  /** Decodes an ini file lazily from the given string. Only the section
+   * headers are located up front, the fields of a section are parsed on its
+   * first access through operator[], at, find or iteration. The content is
+   * kept until all sections are parsed. Results are the same as with Decode,
+   * but errors in the fields of a section are only thrown on its first
+   * access, and a section with errors stays pending and throws on every
+   * access. Parser settings must not change while sections are pending.
+   * Const members parse pending sections too, so call DecodePending before
+   * a lazily decoded file is read from several threads.
+   * @param content string to be decoded */
+  void DecodeLazy(std::string content) {
+    const std::shared_ptr<std::string> owner = std::make_shared<std::string>(std::move(content));
+    IndexSections(std::shared_ptr<const char>(owner, owner->data()), owner->size());
+  }
+
+  /** Loads an ini file lazily, see DecodeLazy. The file is read into a
+   * buffer that is kept until all sections are parsed, so later changes to
+   * the file do not affect the pending sections.
+   * @param file_name path to the file that should be loaded */
+  void LoadLazy(const std::string& file_name) {
+    FileStamp stamp;
+    const bool exists = StatFile(file_name, stamp);
+    const std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(file_name, MappedFile::kRead);
+    IndexSections(std::shared_ptr<const char>(file, file->data()), file->size());
+    if (exists)
+      RememberSource(file_name, stamp, FastHash(file->data(), file->size()), &IniFileBase::DecodeAll);
+  }
+
+  /** Parses all sections that are still pending after DecodeLazy or
+   * LoadLazy, after which the file can be shared between threads.
+   * @throws std::logic_error if the fields of a section are malformed */
+  void DecodePending() { MaterializeAll(); }
+
+  /** Tries to load and decode an ini file from the file at the given path.
+   * The file is read into a buffer, so a concurrent writer cannot crash
+   * the process.
+   * @param file_name path to the file that should be loaded. */
+  void Load(const std::string& file_name) { LoadFile(file_name, MappedFile::kRead, &IniFileBase::DecodeAll); }
+
+  /** Loads an ini file like Load, but memory maps regular files on POSIX
+   * systems and decodes them in place, which saves copying large files.
+   * Only use it for files the program controls: if another process
+   * truncates the file while it is decoded, reading it raises SIGBUS.
+   * @param file_name path to the file that should be loaded. */
+  void LoadMapped(const std::string& file_name) { LoadFile(file_name, MappedFile::kMap, &IniFileBase::DecodeAll); }
+
+  /** Loads the file of the last Load again if it changed since, with the
+   * options that Load used: the same section filter, threads for
+   * LoadParallel, and an eager decode after LoadLazy. A stat of
+   * the file tells whether its identity, size or modification time
+   * changed; if not, the call returns right away. Otherwise the file is
+   * hashed and only decoded if its contents changed. The contents are
+   * decoded into a separate file first, so they are kept if decoding
+   * throws. Files modified within the second they were read are always
+   * hashed, since a later change could keep their modification time. The
+   * file is read into a buffer like with Load.
+   * @return whether the file and its decoded contents changed */
+  ReloadResult ReloadIfChanged() {
+    FileStamp stamp;
+    if (source_file_.empty() || !StatFile(source_file_, stamp))
+      return ReloadResult::kMissing;
+    if (stamp == source_stamp_ && stamp.mtime != 0 && stamp.mtime < source_read_at_)
+      return ReloadResult::kUnchanged;
+
+    MappedFile file(source_file_, MappedFile::kRead);
+    const std::uint64_t hash = FastHash(file.data(), file.size());
+    if (hash == source_hash_) {
+      source_stamp_ = stamp;
+      source_read_at_ = std::time(nullptr);
+      return ReloadResult::kUnchanged;
+    }
+
+    IniFileBase next;
+    next.CopySettingsFrom(*this);
+    source_decode_(next, file.data(), file.size());
+    const bool same = ContentEquals(next);
+    MapType::swap(next);
+    // sections of a lazy load that were not compared are replaced as well
+    lazy_data_.reset();
+    lazy_ranges_.clear();
+    lazy_pending_ = 0;
+    generation_.Next();
+    source_stamp_ = stamp;
+    source_hash_ = hash;
+    source_read_at_ = std::time(nullptr);
+    return same ? ReloadResult::kSameContents : ReloadResult::kChanged;
+  }
+
+  /** Loads an ini file and decodes only the sections that the given filter
+   * selects, see Decode(const char*, std::size_t, const SectionFilter&).
+   * @param file_name path to the file that should be loaded
+   * @param select returns true for the names of sections to decode */
+  void Load(const std::string& file_name, const SectionFilter& select) {
+    LoadFile(file_name, MappedFile::kRead, [select](IniFileBase& inif, const char* data, const std::size_t size) {
+      inif.Decode(data, size, select);
+    });
+  }
+
+  /** Loads an ini file and decodes only the sections with the given names.
+   * @param file_name path to the file that should be loaded
+   * @param sections names of the sections to decode */
+  void Load(const std::string& file_name, const std::vector<std::string>& sections) {
+    Load(file_name, SelectSections(sections));
+  }
+
+  /** Loads an ini file and decodes it on several threads, see DecodeParallel.
+   * @param file_name path to the file that should be loaded
+   * @param thread_count number of threads to use, 0 picks automatically */
+  void LoadParallel(const std::string& file_name, const unsigned thread_count = 0) {
+    LoadFile(file_name, MappedFile::kRead, [thread_count](IniFileBase& inif, const char* data, const std::size_t size) {
+      inif.DecodeParallel(data, size, thread_count);
+    });
+  }
+
+  /** Saves this inifile object as compiled snapshot that CompiledIniBase and
+   * LoadCompiled read without parsing. The snapshot replaces the given path
+   * through ReplaceFile, so processes that have the old snapshot open keep
+   * a consistent view and concurrent saves do not tear it.
+   * @param file_name path to the snapshot
+   * @param source_file path to the text file the contents were loaded
+   * from, its size, modification time and hash are recorded to detect when
+   * the snapshot becomes stale
+   * @return false if the snapshot could not be written, an existing one is
+   * then left as it was */
+  bool SaveCompiled(const std::string& file_name, const std::string& source_file = std::string()) const {
+    using Order = CompiledOrder<Comparator>;
+    using SectionPair = typename MapType::value_type;
+    using FieldPair = typename SectionType::value_type;
+
+    std::vector<const SectionPair*> sections;
+    for (const SectionPair& pair : *this)
+      sections.push_back(&pair);
+    std::sort(sections.begin(), sections.end(),
+              [](const SectionPair* lhs, const SectionPair* rhs) { return Order::Less(lhs->first, rhs->first); });
+
+    std::vector<CompiledSection> section_table;
+    std::vector<CompiledField> field_table;
+    std::string strings;
+    std::vector<const FieldPair*> fields;
+    section_table.reserve(sections.size());
+    for (const SectionPair* section : sections) {
+      fields.clear();
+      for (const FieldPair& pair : section->second)
+        fields.push_back(&pair);
+      std::sort(fields.begin(), fields.end(),
+                [](const FieldPair* lhs, const FieldPair* rhs) { return Order::Less(lhs->first, rhs->first); });
+
+      CompiledSection section_entry;
+      section_entry.name_offset = strings.size();
+      section_entry.name_size = static_cast<std::uint32_t>(section->first.size());
+      section_entry.first_field = field_table.size();
+      section_entry.field_count = static_cast<std::uint32_t>(fields.size());
+      section_table.push_back(section_entry);
+      strings.append(section->first.data(), section->first.size());
+      for (const FieldPair* field : fields) {
+        CompiledField field_entry;
+        field_entry.name_offset = strings.size();
+        field_entry.name_size = static_cast<std::uint32_t>(field->first.size());
+        strings.append(field->first.data(), field->first.size());
+        field_entry.value_offset = strings.size();
+        field_entry.value_size = static_cast<std::uint32_t>(field->second.Value().size());
+        strings += field->second.Value();
+        field_table.push_back(field_entry);
+      }
+    }
+
+    const std::size_t sections_size = section_table.size() * sizeof(CompiledSection);
+    const std::size_t fields_size = field_table.size() * sizeof(CompiledField);
+    // the header is filled in once the body is known
+    std::string contents(sizeof(CompiledHeader), '\0');
+    contents.reserve(sizeof(CompiledHeader) + sections_size + fields_size + strings.size());
+    contents.append(reinterpret_cast<const char*>(section_table.data()), sections_size);
+    contents.append(reinterpret_cast<const char*>(field_table.data()), fields_size);
+    contents += strings;
+    const char* const body = contents.data() + sizeof(CompiledHeader);
+    const std::size_t body_size = contents.size() - sizeof(CompiledHeader);
+
+    CompiledHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "INICPPC", 8);
+    header.version = CompiledHeader::kVersion;
+    header.order = Order::kTag;
+    header.file_size = contents.size();
+    header.checksum = FastHash(body, body_size);
+    header.options = OptionsHash();
+    FileStamp stamp;
+    if (!source_file.empty() && StatFile(source_file, stamp)) {
+      header.source_size = stamp.size;
+      header.source_mtime = stamp.mtime;
+      MappedFile source(source_file, MappedFile::kRead);
+      header.source_hash = FastHash(source.data(), source.size());
+    }
+    header.section_count = section_table.size();
+    header.field_count = field_table.size();
+    header.strings_offset = sizeof(CompiledHeader) + sections_size + fields_size;
+    header.strings_size = strings.size();
+
+    std::memcpy(&contents[0], &header, sizeof(header));
+    return ReplaceFile(file_name, contents.data(), contents.size());
+  }
+
+  /** Loads a compiled snapshot written by SaveCompiled. If a source file
+   * is given and the snapshot is missing, corrupt, stale or was decoded with
+   * other options, the source file is loaded instead and the snapshot is
+   * rebuilt.
+   * @param file_name path to the snapshot
+   * @param source_file path to the text file the snapshot is built from
+   * @throws std::runtime_error if the snapshot cannot be used and no source
+   * file is given */
+  void LoadCompiled(const std::string& file_name, const std::string& source_file = std::string()) {
+    // the stamp is taken first, so a change of the source while the
+    // snapshot is checked is detected by ReloadIfChanged
+    FileStamp stamp;
+    const bool source_exists = !source_file.empty() && StatFile(source_file, stamp);
+    CompiledIniBase<Comparator> compiled;
+    if (compiled.Open(file_name) && compiled.OptionsHash() == OptionsHash() &&
+        (source_file.empty() || compiled.IsFresh(source_file)) && compiled.Verify()) {
+      this->clear();
+      for (std::size_t i = 0; i < compiled.SectionCount(); ++i) {
+        const StringView section_name = compiled.SectionName(i);
+        SectionType& section = (*this)[std::string(section_name.data(), section_name.size())];
+        for (std::size_t j = 0; j < compiled.FieldCount(i); ++j) {
+          const StringView name = compiled.FieldName(i, j);
+          const StringView value = compiled.FieldValue(i, j);
+          section[std::string(name.data(), name.size())].Assign(value);
+        }
+      }
+      if (source_exists)
+        RememberSource(source_file, stamp, compiled.SourceHash(), &IniFileBase::DecodeAll);
+      return;
+    }
+
+    if (source_file.empty())
+      INICPP_THROW(std::runtime_error, "compiled ini file is missing, corrupt or decoded with other options");
+    Load(source_file);
+    SaveCompiled(file_name, source_file);
+  }
 
-  template <typename T>
-  T As() const {
-    Convert<T> conv;
-    T result;
-    conv.Decode(value_, result);
-    return result;
+  /** Encodes this inifile object and writes the output to the given stream.
+   * @param os target stream. */
+  void Encode(std::ostream& os) const {
+    // containers that are not sorted are encoded through a sorted view,
+    // unless they keep the order entries were inserted in
+    if (!ContainerTraits<Container>::kSorted && !ContainerTraits<Container>::kKeepOrder) {
+      for (const auto* file_pair : SortedEntries(*this))
+        EncodeSection(os, file_pair->first, file_pair->second);
+      return;
+    }
+    // iterate through all sections in this file
+    for (const auto& file_pair : *this)
+      EncodeSection(os, file_pair.first, file_pair.second);
   }
 
-  template <typename T>
-  IniField& operator=(const T& value) {
-    Convert<T> conv;
-    conv.Encode(value, value_);
-    return *this;
+  /** Encodes this inifile object as string and returns the result.
+   * @return encoded infile string. */
+  std::string Encode() const {
+    std::ostringstream ss;
+    Encode(ss);
+    return ss.str();
   }
 
-  IniField& operator=(const IniField& field) {
-    value_ = field.value_;
-    return *this;
+  /** Saves this inifile object to the file at the given path.
+   * @param file_name path to the file where the data should be stored. */
+  void Save(const std::string& file_name) const {
+    std::ofstream os(file_name.c_str());
+    Encode(os);
   }
 };
 
-struct StringInsensitiveLess {
-  bool operator()(std::string lhs, std::string rhs) const {
-    std::transform(lhs.begin(), lhs.end(), lhs.begin(), [](const char c) { return static_cast<char>(::tolower(c)); });
-    std::transform(rhs.begin(), rhs.end(), rhs.begin(), [](const char c) { return static_cast<char>(::tolower(c)); });
-    return lhs < rhs;
+/** Section and field name of a file resolved to the field. The field is
+ * looked up again only after the generation of the file changed. The file
+ * must outlive the handle. A handle caches its lookup, so it must not be
+ * shared between threads. */
+template <typename Comparator, typename Container = MapContainer>
+class IniFieldHandle {
+ private:
+  using FieldType = typename IniSectionBase<Comparator, Container>::FieldType;
+
+  const IniFileBase<Comparator, Container>* file_;
+  std::string section_;
+  std::string name_;
+  mutable const IniSectionBase<Comparator, Container>* resolved_section_ = nullptr;
+  mutable const FieldType* field_ = nullptr;
+  // generation resolved_section_ was resolved in, 0 is never a generation
+  mutable std::uint64_t generation_ = 0;
+  // version of resolved_section_ field_ was resolved in
+  mutable std::uint64_t section_version_ = 0;
+
+  void FindField() const {
+    field_ = nullptr;
+    if (resolved_section_ == nullptr)
+      return;
+    const auto field = resolved_section_->find(name_);
+    if (field != resolved_section_->end())
+      field_ = &field->second;
+    section_version_ = resolved_section_->version_;
   }
-};
 
-template <typename Comparator>
-class IniSectionBase : public std::map<std::string, IniField, Comparator> {
  public:
-  IniSectionBase() {}
-  ~IniSectionBase() {}
+  IniFieldHandle(const IniFileBase<Comparator, Container>& file, std::string section, std::string name)
+      : file_(&file), section_(std::move(section)), name_(std::move(name)) {}
+
+  /** Returns the field, or nullptr if there is no such field. */
+  const FieldType* Find() const {
+    if (generation_ != file_->Generation()) {
+      resolved_section_ = nullptr;
+      const auto section = file_->find(section_);
+      if (section != file_->end())
+        resolved_section_ = &section->second;
+      generation_ = file_->Generation();
+      FindField();
+    } else if (resolved_section_ != nullptr && section_version_ != resolved_section_->version_) {
+      // the section is where it was, but its fields may have moved
+      FindField();
+    }
+    return field_;
+  }
+
+  /** Returns true if the field exists. */
+  bool Exists() const { return Find() != nullptr; }
+
+  /** Returns the field.
+   * @throws std::out_of_range if there is no such field */
+  const FieldType& Get() const {
+    const FieldType* field = Find();
+    if (field == nullptr)
+      ThrowOutOfRange("field not found");
+    return *field;
+  }
+
+  /** Decodes the field, see IniField::As.
+   * @throws std::out_of_range if there is no such field */
+  template <typename T>
+  T As() const {
+    return Get().template As<T>();
+  }
+
+  const std::string& Section() const { return section_; }
+
+  const std::string& Name() const { return name_; }
 };
 
-using IniSection = IniSectionBase<std::less<std::string>>;
+using IniFile = IniFileBase<StringLess>;
+using IniSection = IniSectionBase<StringLess>;
+using IniFileCaseInsensitive = IniFileBase<StringInsensitiveLess>;
 using IniSectionCaseInsensitive = IniSectionBase<StringInsensitiveLess>;
 
+/************************************************
+ * Lossless Documents
+ ************************************************/
+
+/** Ini file that keeps its text as it was read, including comments, blank
+ * lines, order and formatting. Values are edited in place: the byte range
+ * of each value is recorded when the text is decoded, and edits are kept
+ * as patches that are spliced into the text when it is encoded or saved.
+ * Fields that are added go after the last field of their section, new
+ * sections go to the end. If every edit fits into the range of the value
+ * it replaces, Save overwrites just those ranges of the file. */
 template <typename Comparator>
-class IniFileBase : public std::map<std::string, IniSectionBase<Comparator>, Comparator> {
+class IniDocumentBase {
  private:
-  char field_sep_ = '=';
-  char esc_ = '\\';
-  std::vector<std::string> comment_prefixes_ = {"#", ";"};
-  bool multi_line_values_ = false;
-  bool overwrite_duplicate_fields_ = true;
+  struct FieldNode {
+    // value as decoded, or as set last
+    std::string value;
+    // range of the value in text_, unused for fields that were added; for
+    // multi-line values the range of the first line
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    // ranges of the continuation lines that a new value removes: the
+    // whole line, or only the value if the line has a comment
+    std::vector<std::pair<std::size_t, std::size_t>> continued;
+    bool dirty = false;
+    bool added = false;
+  };
 
-  void EraseComment(const std::string& comment_prefix, std::string& str, std::string::size_type startpos = 0) {
-    size_t prefixpos = str.find(comment_prefix, startpos);
-    if (std::string::npos == prefixpos)
-      return;
-    // Found a comment prefix, is it escaped?
-    if (0 != prefixpos && str[prefixpos - 1] == esc_) {
-      // The comment prefix is escaped, so just delete the escape char
-      // and keep erasing after the comment prefix
-      str.erase(prefixpos - 1, 1);
-      EraseComment(comment_prefix, str, prefixpos - 1 + comment_prefix.size());
-    } else {
-      str.erase(prefixpos);
+  struct SectionNode {
+    std::map<std::string, FieldNode, Comparator> fields;
+    // names of the fields that were added, in order
+    std::vector<std::string> added_fields;
+    // fields are added in front of this position of text_: the start of
+    // the line after the last field, or after the header
+    std::size_t insert_at = 0;
+    bool added = false;
+  };
+
+  /** Replacement of a range of text_. */
+  struct Patch {
+    std::size_t begin;
+    std::size_t end;
+    std::string text;
+    FieldNode* field;
+  };
+
+  /** Records the sections and fields of the text and the ranges of their
+   * values. Views from the parser may point into a scratch buffer, so
+   * ranges are located in the lines of the text instead. */
+  class IndexHandler : public IniHandler {
+   private:
+    IniDocumentBase& document_;
+    const char* const data_;
+    const char* const end_;
+    // number and start of the line that was located last
+    int line_no_ = 1;
+    const char* line_;
+    std::string scratch_;
+    SectionNode* section_ = nullptr;
+    FieldNode* field_ = nullptr;
+
+    /** Returns the end of the line that was located last. */
+    const char* LineEnd() const {
+      const char* newline = static_cast<const char*>(std::memchr(line_, '\n', static_cast<std::size_t>(end_ - line_)));
+      return newline == nullptr ? end_ : newline;
+    }
+
+    /** Returns the line with the given number without its '\n', lines are
+     * requested in ascending order. */
+    StringView Line(const int line_no) {
+      for (; line_no_ < line_no; ++line_no_) {
+        const char* const line_end = LineEnd();
+        line_ = line_end == end_ ? end_ : line_end + 1;
+      }
+      return StringView(line_, static_cast<std::size_t>(LineEnd() - line_));
+    }
+
+    /** Returns the offset of the line after the given one. */
+    std::size_t NextLine(const StringView line) const {
+      const char* const line_end = line.data() + line.size();
+      return static_cast<std::size_t>((line_end == end_ ? line_end : line_end + 1) - data_);
+    }
+
+    /** Locates a value reported for the given line. The parser reports the
+     * value as the trimmed end of the line without its comment, so its
+     * range is found in the stripped line and mapped back. */
+    void ValueRange(const StringView line, const StringView value, std::size_t& begin, std::size_t& end) {
+      const IniParser& parser = document_.parser_;
+      parser.StripComment(line, scratch_);
+      const StringView stripped = Trim(StringView(scratch_));
+      const std::size_t value_end = static_cast<std::size_t>(stripped.data() - scratch_.data()) + stripped.size();
+      begin = static_cast<std::size_t>(parser.StrippedPosition(line, value_end - value.size()) - data_);
+      end = static_cast<std::size_t>(parser.StrippedPosition(line, value_end) - data_);
+    }
+
+   public:
+    IndexHandler(IniDocumentBase& document, const char* data, const std::size_t size)
+        : document_(document), data_(data), end_(data + size), line_(data) {}
+
+    bool OnSection(const int line_no, const StringView name) {
+      section_ = &document_.sections_[std::string(name)];
+      section_->insert_at = NextLine(Line(line_no));
+      field_ = nullptr;
+      return true;
+    }
+
+    bool OnField(const int line_no, const StringView name, const StringView value) {
+      const StringView line = Line(line_no);
+      field_ = &section_->fields[std::string(name)];
+      field_->value.assign(value.data(), value.size());
+      field_->continued.clear();
+      ValueRange(line, value, field_->begin, field_->end);
+      section_->insert_at = NextLine(line);
+      return true;
+    }
+
+    bool OnContinuation(const int line_no, const StringView value) {
+      if (field_ == nullptr)
+        return true;
+      const StringView line = Line(line_no);
+      field_->value.append(1, '\n').append(value.data(), value.size());
+      std::pair<std::size_t, std::size_t> range;
+      ValueRange(line, value, range.first, range.second);
+      // comment lines in between and comments after the value are kept
+      const std::size_t line_begin = static_cast<std::size_t>(line.data() - data_);
+      if (Trim(StringView(data_ + range.second, line_begin + line.size() - range.second)).empty())
+        range = std::make_pair(line_begin, NextLine(line));
+      field_->continued.push_back(range);
+      section_->insert_at = NextLine(line);
+      return true;
     }
+
+    bool OnError(const ParseError& error) {
+      document_.ThrowParseError(error);
+      return false;
+    }
+  };
+
+  IniParser parser_;
+  std::string text_;
+  std::map<std::string, SectionNode, Comparator> sections_;
+  // names of the sections that were added, in order
+  std::vector<std::string> added_sections_;
+  // fields whose value was set since the text was decoded or saved
+  std::vector<FieldNode*> dirty_;
+  // file of the last Load or Save and its stamp at that time
+  std::string file_name_;
+  FileStamp stamp_;
+
+  void ThrowParseError(const ParseError& error) const {
+    INICPP_THROW(std::logic_error, DescribeParseError(error, parser_).c_str());
+  }
+
+  std::string Escaped(const StringView str) const {
+    std::string out;
+    parser_.Escape(str, [&out](const char* data, const std::size_t size) { out.append(data, size); });
+    return out;
+  }
+
+  void AppendField(std::string& out, const std::string& name, const FieldNode& field) const {
+    out += Escaped(name);
+    out += parser_.FieldSep();
+    out += Escaped(field.value);
+    out += '\n';
   }
 
-  void EraseComments(std::string& str) {
-    for (const std::string& comment_prefix : comment_prefixes_)
-      EraseComment(comment_prefix, str);
+  /** Text that is inserted in front of the given position, starting on a
+   * line of its own. */
+  std::string InsertedText(const std::size_t pos) const {
+    return pos != 0 && text_[pos - 1] != '\n' ? std::string(1, '\n') : std::string();
   }
 
-  /** Tries to find a suitable comment prefix for the string data at the given
-   * position. Returns comment_prefixes_.end() if no match was found. */
-  std::vector<std::string>::const_iterator FindCommentPrefix(const std::string& str, const std::size_t startpos) const {
-    // if startpos is invalid simply return "not found"
-    if (startpos >= str.size())
-      return comment_prefixes_.end();
+  /** Text that replaces the range of a decoded value. A comment that
+   * directly follows the range is moved away by a space, so that it can
+   * neither be escaped by a trailing escape char nor start within the
+   * value, e.g. "x/" in front of "//c". */
+  std::string SplicedValue(const FieldNode& field) const {
+    std::string text = Escaped(field.value);
+    if (!text.empty() && field.end < text_.size() && !IsWhitespace(text_[field.end]))
+      text += ' ';
+    return text;
+  }
 
-    for (size_t i = 0; i < comment_prefixes_.size(); ++i) {
-      const std::string& prefix = comment_prefixes_[i];
-      // if this comment prefix is longer than the string view itself
-      // then skip
-      if (prefix.size() + startpos > str.size())
+  /** Returns the edits as patches of text_, ordered by position. Sections
+   * that were added come after fields added at the end of the text. */
+  std::vector<Patch> Patches() const {
+    std::vector<Patch> patches;
+    for (FieldNode* field : dirty_) {
+      if (field->added)
+        continue;
+      patches.push_back(Patch{field->begin, field->end, SplicedValue(*field), field});
+      for (const auto& range : field->continued)
+        patches.push_back(Patch{range.first, range.second, std::string(), field});
+    }
+    for (const auto& section_pair : sections_) {
+      const SectionNode& section = section_pair.second;
+      if (section.added || section.added_fields.empty())
         continue;
+      Patch patch{section.insert_at, section.insert_at, InsertedText(section.insert_at), nullptr};
+      for (const std::string& name : section.added_fields)
+        AppendField(patch.text, name, section.fields.find(name)->second);
+      patches.push_back(std::move(patch));
+    }
+    if (!added_sections_.empty()) {
+      // fields added to a section at the end of the text already start the
+      // line the new sections follow
+      if (patches.empty() || patches.back().field != nullptr || patches.back().begin != text_.size())
+        patches.push_back(Patch{text_.size(), text_.size(), InsertedText(text_.size()), nullptr});
+      std::string& text = patches.back().text;
+      for (const std::string& section_name : added_sections_) {
+        const SectionNode& section = sections_.find(section_name)->second;
+        // sections are separated by an empty line
+        if (!text_.empty() || !text.empty())
+          text += '\n';
+        text += '[';
+        text += Escaped(section_name);
+        text += "]\n";
+        for (const std::string& name : section.added_fields)
+          AppendField(text, name, section.fields.find(name)->second);
+      }
+    }
+    std::stable_sort(patches.begin(), patches.end(),
+                     [](const Patch& lhs, const Patch& rhs) { return lhs.begin < rhs.begin; });
+    return patches;
+  }
+
+  /** Overwrites the ranges of the edited values in the file of the last
+   * Load or Save, padding shorter values with spaces.
+   * @return false if an edit does not fit or the file changed, nothing is
+   * written then */
+  bool SaveInPlace() {
+    if (file_name_.empty() || !added_sections_.empty())
+      return false;
+    std::vector<Patch> patches = Patches();
+    for (const Patch& patch : patches) {
+      if (patch.field == nullptr || patch.text.size() > patch.end - patch.begin)
+        return false;
+    }
+    FileStamp stamp;
+    if (!StatFile(file_name_, stamp) || stamp != stamp_ || stamp.size != text_.size())
+      return false;
 
-      bool match = true;
-      for (size_t j = 0; j < prefix.size() && match; ++j)
-        match = str[startpos + j] == prefix[j];
+#ifdef INICPP_HAS_MMAP
+    const int fd = ::open(file_name_.c_str(), O_WRONLY);
+    if (fd < 0)
+      return false;
+#else
+    std::fstream os(file_name_.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (!os.is_open())
+      return false;
+#endif
+    bool written = true;
+    for (Patch& patch : patches) {
+      const std::size_t span = patch.end - patch.begin;
+      patch.end = patch.begin + patch.text.size();
+      patch.text.resize(span, ' ');
+      // a removed continuation line is left blank
+      if (span != 0 && text_[patch.begin + span - 1] == '\n')
+        patch.text.back() = '\n';
+#ifdef INICPP_HAS_MMAP
+      written = written && ::pwrite(fd, patch.text.data(), span, static_cast<off_t>(patch.begin)) ==
+                               static_cast<ssize_t>(span);
+#else
+      os.seekp(static_cast<std::streamoff>(patch.begin));
+      os.write(patch.text.data(), static_cast<std::streamsize>(span));
+      written = written && os.good();
+#endif
+    }
+#ifdef INICPP_HAS_MMAP
+    ::close(fd);
+#endif
+    // the whole text is written instead, which also repairs partial writes
+    if (!written)
+      return false;
 
-      if (match)
-        return comment_prefixes_.begin() + i;
+    for (const Patch& patch : patches) {
+      text_.replace(patch.begin, patch.text.size(), patch.text);
+      if (patch.begin == patch.field->begin)
+        patch.field->end = patch.end;
+      patch.field->continued.clear();
+      patch.field->dirty = false;
     }
+    dirty_.clear();
+    StatFile(file_name_, stamp_);
+    return true;
+  }
+
+ public:
+  IniDocumentBase() = default;
+
+  IniDocumentBase(const char field_sep, const std::vector<std::string>& comment_prefixes)
+      : parser_(field_sep, comment_prefixes) {}
 
-    return comment_prefixes_.end();
+  /** Copies would share nothing but the parse options, see Decode. */
+  IniDocumentBase(const IniDocumentBase&) = delete;
+  IniDocumentBase& operator=(const IniDocumentBase&) = delete;
+
+  /** Parse options, see IniFileBase. They apply to the next Decode or Load
+   * and to the values that are set. */
+  void SetFieldSep(const char sep) { parser_.SetFieldSep(sep); }
+  void SetCommentPrefixes(const std::vector<std::string>& comment_prefixes) {
+    parser_.SetCommentPrefixes(comment_prefixes);
   }
+  void SetEscapeChar(const char esc) { parser_.SetEscapeChar(esc); }
+  void SetMultiLineValues(const bool enable) { parser_.SetMultiLineValues(enable); }
 
-  void WriteEscaped(std::ostream& os, const std::string& str) const {
-    for (size_t i = 0; i < str.length(); ++i) {
-      auto prefixpos = FindCommentPrefix(str, i);
-      // if no suitable prefix was found at this position
-      // then simply write the current character
-      if (prefixpos != comment_prefixes_.end()) {
-        const std::string& prefix = *prefixpos;
-        os.put(esc_);
-        os.write(prefix.c_str(), prefix.size());
-        i += prefix.size() - 1;
-      } else if (multi_line_values_ && str[i] == '\n') {
-        os.write("\n\t", 2);
-      } else {
-        os.put(str[i]);
-      }
+  /** Decodes the given text, which is kept as is. Later duplicates of a
+   * field overwrite earlier ones, and setting the field edits the last one.
+   * @throws std::logic_error if the text is malformed */
+  void Decode(std::string text) {
+    text_ = std::move(text);
+    sections_.clear();
+    added_sections_.clear();
+    dirty_.clear();
+    file_name_.clear();
+    IndexHandler handler(*this, text_.data(), text_.size());
+    parser_.Parse(text_.data(), text_.size(), handler);
+  }
+
+  /** Reads and decodes the file at the given path, which Save() writes to.
+   * A missing file is decoded as empty. */
+  void Load(const std::string& file_name) {
+    FileStamp stamp;
+    const bool exists = StatFile(file_name, stamp);
+    MappedFile file(file_name, MappedFile::kRead);
+    Decode(std::string(file.data(), file.size()));
+    file_name_ = file_name;
+    stamp_ = exists ? stamp : FileStamp();
+  }
+
+  /** Returns true if the section has a field with the given name. */
+  bool Contains(const std::string& section, const std::string& name) const {
+    const auto it = sections_.find(section);
+    return it != sections_.end() && it->second.fields.count(name) != 0;
+  }
+
+  /** Returns the current value of a field.
+   * @throws std::out_of_range if there is no such field */
+  IniField Get(const std::string& section, const std::string& name) const {
+    const auto it = sections_.find(section);
+    if (it == sections_.end() || it->second.fields.count(name) == 0)
+      ThrowOutOfRange("field not found");
+    return IniField(it->second.fields.find(name)->second.value);
+  }
+
+  /** Sets the value of a field, the section and the field are added if
+   * they do not exist. Only the edit is recorded, the text is patched when
+   * it is encoded or saved. */
+  template <typename T>
+  void Set(const std::string& section, const std::string& name, const T& value) {
+    auto section_it = sections_.find(section);
+    if (section_it == sections_.end()) {
+      section_it = sections_.emplace(section, SectionNode()).first;
+      section_it->second.added = true;
+      added_sections_.push_back(section);
+    }
+    SectionNode& node = section_it->second;
+    auto field_it = node.fields.find(name);
+    if (field_it == node.fields.end()) {
+      field_it = node.fields.emplace(name, FieldNode()).first;
+      field_it->second.added = true;
+      node.added_fields.push_back(name);
+    }
+    FieldNode& field = field_it->second;
+    Convert<T> conv;
+    conv.Encode(value, field.value);
+    if (!field.dirty) {
+      field.dirty = true;
+      dirty_.push_back(&field);
+    }
+  }
+
+  /** Returns the number of fields that were set since the text was decoded
+   * or saved. */
+  std::size_t PendingEdits() const { return dirty_.size(); }
+
+  /** Writes the text with all edits spliced in. */
+  void Encode(std::ostream& os) const {
+    std::size_t pos = 0;
+    for (const Patch& patch : Patches()) {
+      os.write(text_.data() + pos, static_cast<std::streamsize>(patch.begin - pos));
+      os.write(patch.text.data(), static_cast<std::streamsize>(patch.text.size()));
+      pos = patch.end;
     }
+    os.write(text_.data() + pos, static_cast<std::streamsize>(text_.size() - pos));
+  }
+
+  std::string Encode() const {
+    std::ostringstream ss;
+    Encode(ss);
+    return ss.str();
+  }
+
+  /** Saves the edits to the file of the last Load or Save. If each edit
+   * fits into the range of the value it replaces and the file has not
+   * changed since, only those ranges are overwritten, shorter values are
+   * padded with spaces. Otherwise the whole text replaces the file, see
+   * Save(const std::string&).
+   * @return false if the file could not be written, the edits are then
+   * kept
+   * @throws std::logic_error if the document was not loaded from a file */
+  bool Save() {
+    if (file_name_.empty())
+      INICPP_THROW(std::logic_error, "ini document has no file");
+    if (dirty_.empty() && added_sections_.empty())
+      return true;
+    return SaveInPlace() || Save(file_name_);
+  }
+
+  /** Writes the text with all edits to the file at the given path and
+   * decodes it again, later calls of Save() write to this file. The file
+   * is replaced through ReplaceFile, so readers never see a partly written
+   * file.
+   * @return false if the file could not be written, it is then left as it
+   * was and the document keeps its text and edits */
+  bool Save(const std::string& file_name) {
+    std::string text = Encode();
+    if (!ReplaceFile(file_name, text.data(), text.size()))
+      return false;
+    Decode(std::move(text));
+    file_name_ = file_name;
+    StatFile(file_name_, stamp_);
+    return true;
   }
 
+  /** Returns the text as it was decoded or last saved, without pending
+   * edits. */
+  const std::string& Text() const { return text_; }
+};
+
+using IniDocument = IniDocumentBase<StringLess>;
+using IniDocumentCaseInsensitive = IniDocumentBase<StringInsensitiveLess>;
+
+/************************************************
+ * Snapshot Publishing
+ ************************************************/
+
+/** Publishes immutable snapshots of an ini file to concurrent readers.
+ * A writer builds a new file and publishes it without blocking readers.
+ * Each reader thread uses its own Reader, which keeps the snapshot it
+ * returned alive until its next call, so a request sees one consistent
+ * version. While nothing new is published, Reader::Get only loads a
+ * version counter that all readers share without writing to it, so reads
+ * are wait-free and do not contend. Old snapshots are freed when the last
+ * reader has moved on.
+ *
+ *   ini::IniHolder holder;
+ *   holder.Publish(std::move(inif));           // writer
+ *   ini::IniHolder::Reader reader(holder);     // one per reader thread
+ *   const ini::IniFile& config = reader.Get(); */
+template <typename File>
+class IniHolderBase {
+ private:
+#ifdef __cpp_lib_atomic_shared_ptr
+  std::atomic<std::shared_ptr<const File>> current_;
+
+  std::shared_ptr<const File> LoadCurrent() const { return current_.load(); }
+  void StoreCurrent(std::shared_ptr<const File> file) { current_.store(std::move(file)); }
+#else
+  std::shared_ptr<const File> current_;
+
+  std::shared_ptr<const File> LoadCurrent() const { return std::atomic_load(&current_); }
+  void StoreCurrent(std::shared_ptr<const File> file) { std::atomic_store(&current_, std::move(file)); }
+#endif
+  // incremented after every publish, readers compare it with their copy
+  std::atomic<std::uint64_t> version_;
+
  public:
-  IniFileBase() = default;
+  /** Reads the snapshots of one holder, use one reader per thread. */
+  class Reader {
+   private:
+    const IniHolderBase* holder_;
+    std::shared_ptr<const File> file_;
+    std::uint64_t version_;
 
-  IniFileBase(const char field_sep, const char comment)
-      : field_sep_(field_sep), comment_prefixes_(1, std::string(1, comment)) {}
+   public:
+    explicit Reader(const IniHolderBase& holder)
+        : holder_(&holder), version_(holder.version_.load(std::memory_order_acquire)) {
+      file_ = holder.LoadCurrent();
+    }
 
-  IniFileBase(const std::string& filename) { Load(filename); }
+    /** Returns the latest snapshot. It stays valid and unchanged until the
+     * next call of Get on this reader, or its destruction. */
+    const File& Get() {
+      const std::uint64_t version = holder_->version_.load(std::memory_order_acquire);
+      if (version != version_) {
+        // read the version first, a snapshot newer than it only causes
+        // one more refresh on the next call
+        version_ = version;
+        file_ = holder_->LoadCurrent();
+      }
+      return *file_;
+    }
 
-  IniFileBase(std::istream& is) { Decode(is); }
+    /** @return version of the snapshot returned by the last Get */
+    std::uint64_t Version() const { return version_; }
+  };
 
-  IniFileBase(const char field_sep, const std::vector<std::string>& comment_prefixes)
-      : field_sep_(field_sep), comment_prefixes_(comment_prefixes) {}
+  /** Starts with an empty file. */
+  IniHolderBase() : current_(std::make_shared<File>()), version_(0) {}
 
-  IniFileBase(const std::string& filename, const char field_sep, const std::vector<std::string>& comment_prefixes)
-      : field_sep_(field_sep), comment_prefixes_(comment_prefixes) {
-    Load(filename);
-  }
+  /** Starts with the given file. */
+  explicit IniHolderBase(std::shared_ptr<const File> file) : current_(std::move(file)), version_(0) {}
 
-  IniFileBase(std::istream& is, const char field_sep, const std::vector<std::string>& comment_prefixes)
-      : field_sep_(field_sep), comment_prefixes_(comment_prefixes) {
-    Decode(is);
+  IniHolderBase(const IniHolderBase&) = delete;
+  IniHolderBase& operator=(const IniHolderBase&) = delete;
+
+  /** Publishes the given file, readers pick it up on their next Get. */
+  void Publish(std::shared_ptr<const File> file) {
+    StoreCurrent(std::move(file));
+    version_.fetch_add(1, std::memory_order_release);
   }
 
-  ~IniFileBase() {}
+  /** Publishes the given file, see Publish(std::shared_ptr<const File>). */
+  void Publish(File file) { Publish(std::make_shared<File>(std::move(file))); }
 
-  /** Sets the separator character for fields in the INI file.
-   * @param sep separator character to be used. */
-  void SetFieldSep(const char sep) { field_sep_ = sep; }
+  /** Returns the latest snapshot. This copies a shared_ptr, so frequent
+   * readers should use a Reader instead. */
+  std::shared_ptr<const File> Current() const { return LoadCurrent(); }
 
-  /** Sets the character that should be interpreted as the start of comments.
-   * Default is '#'.
-   * @param comment comment character to be used. */
-  void SetCommentChar(const char comment) { comment_prefixes_ = {std::string(1, comment)}; }
+  /** @return number of publishes so far */
+  std::uint64_t Version() const { return version_.load(std::memory_order_acquire); }
+};
 
-  /** Sets the list of strings that should be interpreted as the start of comments.
-   * Default is [ "#" ].
-   * @param comment_prefixes vector of comment prefix strings to be used. */
-  void SetCommentPrefixes(const std::vector<std::string>& comment_prefixes) { comment_prefixes_ = comment_prefixes; }
+using IniHolder = IniHolderBase<IniFile>;
+using IniHolderCaseInsensitive = IniHolderBase<IniFileCaseInsensitive>;
 
-  /** Sets the character that should be used to escape comment prefixes.
-   * Default is '\'.
-   * @param esc escape character to be used. */
-  void SetEscapeChar(const char esc) { esc_ = esc; }
+#ifdef INICPP_HAS_INOTIFY
+/************************************************
+ * File Watcher
+ ************************************************/
 
-  /** Sets whether or not to parse multi-line field values.
-   * Default is false.
-   * @param enable enable or disable? */
-  void SetMultiLineValues(bool enable) { multi_line_values_ = enable; }
+/** Watches an ini file with inotify and decodes it again on a background
+ * thread when it changes. The directory of the file is watched, so saves
+ * that write a temporary file and rename it over the original are caught as
+ * well as writes in place. Bursts of events are debounced; the file is
+ * decoded once no event arrived for the debounce interval. A decoded file
+ * is only published if it has no errors and its contents changed, readers
+ * keep the previous one otherwise. Files are published through an
+ * IniHolderBase, so readers can use its wait-free Reader. Only available on
+ * Linux.
+ *
+ *   ini::IniWatcher watcher("app.ini");
+ *   ini::IniHolder::Reader reader(watcher.Holder());
+ *   const ini::IniFile& config = reader.Get(); */
+template <typename File>
+class IniWatcherBase {
+ private:
+  const std::string file_name_;
+  std::string base_name_;
+  // copied for every decode, provides the parser settings
+  const File prototype_;
+  const std::chrono::milliseconds debounce_;
 
-  /** Sets whether or not overwriting duplicate fields is allowed.
-   * If overwriting duplicate fields is not allowed,
-   * an exception is thrown when a duplicate field is found inside a section.
-   * Default is true.
-   * @param allowed Is overwriting duplicate fields allowed or not? */
-  void AllowOverwriteDuplicateFields(bool allowed) { overwrite_duplicate_fields_ = allowed; }
+  IniHolderBase<File> holder_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable published_;
+  std::uint64_t version_ = 0;
+  std::uint64_t hash_ = 0;
+  DecodeResult last_result_;
+  // errno of the failure that stopped the background thread, 0 if none
+  int watch_error_ = 0;
 
-  /** Tries to decode an ini file from the given input stream.
-   * @param is input stream from which data should be read. */
-  void Decode(std::istream& is) {
-    this->clear();
-    int line_no = 0;
-    IniSectionBase<Comparator>* current_section = nullptr;
-    std::string multi_line_value_field_name;
-    std::string line;
-    // iterate file line by line
-    while (!is.eof() && !is.fail()) {
-      std::getline(is, line, '\n');
-      EraseComments(line);
-      bool has_indent = line.find_first_not_of(Indents()) != 0;
-      Trim(line);
-      ++line_no;
-
-      // skip if line is empty
-      if (line.size() == 0)
-        continue;
+  int inotify_fd_ = -1;
+  // signals the background thread to stop
+  int wake_fd_ = -1;
+  std::thread thread_;
 
-      if (line[0] == '[') {
-        // line is a section
-        // check if the section is also closed on same line
-        std::size_t pos = line.find("]");
-        if (pos == std::string::npos) {
-          std::stringstream ss;
-          ss << "l." << line_no << ": ini parsing failed, section not closed";
-          INICPP_THROW_SS(std::logic_error, ss);
-        }
-        // check if the section name is empty
-        if (pos == 1) {
-          std::stringstream ss;
-          ss << "l." << line_no << ": ini parsing failed, section is empty";
-          INICPP_THROW_SS(std::logic_error, ss);
-        }
+  void CloseDescriptors() {
+    if (inotify_fd_ >= 0)
+      ::close(inotify_fd_);
+    if (wake_fd_ >= 0)
+      ::close(wake_fd_);
+    inotify_fd_ = -1;
+    wake_fd_ = -1;
+  }
+
+  /** Decodes the file and publishes it if it has no errors and differs
+   * from the published one. The file is read rather than mapped, since the
+   * writes being watched may truncate it at any time. */
+  void Reload() {
+    FileStamp stamp;
+    if (!StatFile(file_name_, stamp))
+      return;
+    MappedFile file(file_name_, MappedFile::kRead);
+    const std::uint64_t hash = FastHash(file.data(), file.size());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // the published contents are back, earlier errors no longer apply
+      if (version_ != 0 && hash == hash_) {
+        last_result_ = DecodeResult();
+        return;
+      }
+    }
 
-        // retrieve section name
-        std::string sec_name = line.substr(1, pos - 1);
-        current_section = &((*this)[sec_name]);
+    std::shared_ptr<File> next = std::make_shared<File>(prototype_);
+    const DecodeResult result = next->TryDecode(file.data(), file.size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_result_ = result;
+    if (!result.Ok())
+      return;
+    holder_.Publish(std::move(next));
+    hash_ = hash;
+    ++version_;
+    published_.notify_all();
+  }
 
-        // clear multiline value field name
-        // a new section means there is no value to continue
-        multi_line_value_field_name = "";
-      } else {
-        // line is a field definition
-        // check if section was already opened
-        if (current_section == nullptr) {
-          std::stringstream ss;
-          ss << "l." << line_no
-             << ": ini parsing failed, field has no section"
-                " or ini file in use by another application";
-          INICPP_THROW_SS(std::logic_error, ss);
-        }
+  /** Records why the background thread stops watching the file. */
+  void StopWatching(const int error) {
+    ParseError failure;
+    failure.line = 0;
+    failure.column = 0;
+    failure.code = ParseErrorCode::kReadFailed;
+    std::lock_guard<std::mutex> lock(mutex_);
+    watch_error_ = error;
+    last_result_ = DecodeResult();
+    last_result_.errors.push_back(failure);
+  }
+
+  void Run() {
+    bool pending = false;
+    std::chrono::steady_clock::time_point deadline;
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+      int timeout = -1;
+      if (pending) {
+        const auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        timeout = remaining.count() > 0 ? static_cast<int>(remaining.count()) : 0;
+      }
 
-        // find key value separator
-        std::size_t pos = line.find(field_sep_);
-        if (multi_line_values_ && has_indent && !multi_line_value_field_name.empty()) {
-          // extend a multi-line value
-          IniField previous_value = (*current_section)[multi_line_value_field_name];
-          std::string value = previous_value.As<std::string>() + "\n" + line;
-          (*current_section)[multi_line_value_field_name] = value;
-        } else if (pos == std::string::npos) {
-          std::stringstream ss;
-          ss << "l." << line_no << ": ini parsing failed, no '" << field_sep_ << "' found";
-          if (multi_line_values_)
-            ss << ", and not a multi-line value continuation";
-          INICPP_THROW_SS(std::logic_error, ss);
-        } else {
-          // retrieve field name and value
-          std::string name = line.substr(0, pos);
-          Trim(name);
-          if (!overwrite_duplicate_fields_ && current_section->count(name) != 0) {
-            std::stringstream ss;
-            ss << "l." << line_no << ": ini parsing failed, duplicate field found";
-            INICPP_THROW_SS(std::logic_error, ss);
+      struct pollfd fds[2];
+      fds[0].fd = inotify_fd_;
+      fds[0].events = POLLIN;
+      fds[0].revents = 0;
+      fds[1].fd = wake_fd_;
+      fds[1].events = POLLIN;
+      fds[1].revents = 0;
+      const int ready = ::poll(fds, 2, timeout);
+      if (ready < 0 && errno != EINTR) {
+        StopWatching(errno);
+        return;
+      }
+      if (ready > 0 && (fds[1].revents & POLLIN) != 0)
+        return;
+      if (ready > 0 && (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+        StopWatching(EIO);
+        return;
+      }
+
+      if (ready > 0 && (fds[0].revents & POLLIN) != 0) {
+        for (;;) {
+          const ssize_t length = ::read(inotify_fd_, buffer, sizeof(buffer));
+          if (length < 0 && errno == EINTR)
+            continue;
+          if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+          if (length <= 0) {
+            StopWatching(length < 0 ? errno : EIO);
+            return;
+          }
+          for (const char* pos = buffer; pos < buffer + length;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(pos);
+            if (event->len != 0 && base_name_ == event->name) {
+              // every event restarts the debounce interval
+              pending = true;
+              deadline = std::chrono::steady_clock::now() + debounce_;
+            }
+            pos += sizeof(struct inotify_event) + event->len;
           }
-          std::string value = line.substr(pos + 1, std::string::npos);
-          Trim(value);
-          (*current_section)[name] = value;
-          // store last field name for potential multi-line values
-          multi_line_value_field_name = name;
         }
       }
+
+      if (pending && std::chrono::steady_clock::now() >= deadline) {
+        pending = false;
+        Reload();
+      }
     }
   }
 
-  /** Tries to decode an ini file from the given input string.
-   * @param content string to be decoded. */
-  void Decode(const std::string& content) {
-    std::istringstream ss(content);
-    Decode(ss);
+ public:
+  /** Decodes the file and starts watching it. If the first decode fails,
+   * Current() returns an empty file until a valid version is written.
+   * @param file_name path to the ini file
+   * @param prototype file whose parser settings are used
+   * @param debounce time without events before the file is decoded
+   * @throws std::runtime_error if the directory cannot be watched */
+  explicit IniWatcherBase(const std::string& file_name, const File& prototype = File(),
+                          const std::chrono::milliseconds debounce = std::chrono::milliseconds(50))
+      : file_name_(file_name), prototype_(prototype), debounce_(debounce) {
+    const std::size_t slash = file_name.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : file_name.substr(0, slash);
+    base_name_ = slash == std::string::npos ? file_name : file_name.substr(slash + 1);
+
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const std::uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_ATTRIB;
+    if (inotify_fd_ < 0 || wake_fd_ < 0 || ::inotify_add_watch(inotify_fd_, directory.c_str(), mask) < 0) {
+      CloseDescriptors();
+      INICPP_THROW(std::runtime_error, "cannot watch the directory of the ini file");
+    }
+
+    Reload();
+    thread_ = std::thread(&IniWatcherBase::Run, this);
   }
 
-  /** Tries to load and decode an ini file from the file at the given path.
-   * @param file_name path to the file that should be loaded. */
-  void Load(const std::string& file_name) {
-    std::ifstream is(file_name.c_str());
-    Decode(is);
+  IniWatcherBase(const IniWatcherBase&) = delete;
+  IniWatcherBase& operator=(const IniWatcherBase&) = delete;
+
+  /** Stops the background thread. */
+  ~IniWatcherBase() {
+    if (thread_.joinable()) {
+      const std::uint64_t one = 1;
+      ssize_t written;
+      do {
+        written = ::write(wake_fd_, &one, sizeof(one));
+      } while (written < 0 && errno == EINTR);
+      thread_.join();
+    }
+    CloseDescriptors();
   }
 
-  /** Encodes this inifile object and writes the output to the given stream.
-   * @param os target stream. */
-  void Encode(std::ostream& os) const {
-    // iterate through all sections in this file
-    for (const auto& file_pair : *this) {
-      os.put('[');
-      WriteEscaped(os, file_pair.first);
-      os.put(']');
-      os.put('\n');
+  /** @return the file that was published last */
+  std::shared_ptr<const File> Current() const { return holder_.Current(); }
 
-      // iterate through all fields in the section
-      for (const auto& sec_pair : file_pair.second) {
-        WriteEscaped(os, sec_pair.first);
-        os.put(field_sep_);
-        WriteEscaped(os, sec_pair.second.template As<std::string>());
-        os.put('\n');
-      }
+  /** @return holder the files are published to, for wait-free readers */
+  const IniHolderBase<File>& Holder() const { return holder_; }
 
-      // Add a newline after each section
-      os.put('\n');
-    }
+  /** @return number of published files, 0 until the file decoded once */
+  std::uint64_t Version() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
   }
 
-  /** Encodes this inifile object as string and returns the result.
-   * @return encoded infile string. */
-  std::string Encode() const {
-    std::ostringstream ss;
-    Encode(ss);
-    return ss.str();
+  /** @return result of the last decode, its errors tell why a change was
+   * not published. If watching failed, it holds a single error with code
+   * ParseErrorCode::kReadFailed and no more changes are picked up. */
+  DecodeResult LastResult() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_result_;
   }
 
-  /** Saves this inifile object to the file at the given path.
-   * @param file_name path to the file where the data should be stored. */
-  void Save(const std::string& file_name) const {
-    std::ofstream os(file_name.c_str());
-    Encode(os);
+  /** @return errno of the failure that stopped watching, 0 while the file
+   * is watched */
+  int WatchError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watch_error_;
+  }
+
+  /** Waits until at least the given number of files was published.
+   * @param version version to wait for
+   * @param timeout maximum time to wait
+   * @return true if the version was reached */
+  bool WaitForVersion(const std::uint64_t version, const std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return published_.wait_for(lock, timeout, [&] { return version_ >= version; });
   }
 };
 
-using IniFile = IniFileBase<std::less<std::string>>;
-using IniSection = IniSectionBase<std::less<std::string>>;
-using IniFileCaseInsensitive = IniFileBase<StringInsensitiveLess>;
-using IniSectionCaseInsensitive = IniSectionBase<StringInsensitiveLess>;
+using IniWatcher = IniWatcherBase<IniFile>;
+using IniWatcherCaseInsensitive = IniWatcherBase<IniFileCaseInsensitive>;
+#endif
 }  // namespace ini
 
 #endif
@@ -0,0 +1,116 @@
+/*
+ * allocation_counter.cpp
+ *
+ * Replaces the global allocation functions to count allocations. All of
+ * them allocate with std::malloc and release with std::free. They are
+ * defined out of line in this file, so the compiler never sees a library
+ * new matched with one of these deletes.
+ */
+
+#include "allocation_counter.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static bool g_count_allocations = false;
+static std::size_t g_allocations = 0;
+static std::size_t g_bytes = 0;
+
+static void* Allocate(const std::size_t size) noexcept {
+  if (g_count_allocations) {
+    ++g_allocations;
+    g_bytes += size;
+  }
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* AllocateOrThrow(const std::size_t size) {
+  void* ptr = Allocate(size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+AllocationCounter::AllocationCounter() {
+  g_allocations = 0;
+  g_bytes = 0;
+  g_count_allocations = true;
+}
+
+AllocationCounter::~AllocationCounter() { g_count_allocations = false; }
+
+std::size_t AllocationCounter::Count() const { return g_allocations; }
+
+std::size_t AllocationCounter::Bytes() const { return g_bytes; }
+
+void* operator new(std::size_t size) { return AllocateOrThrow(size); }
+
+void* operator new[](std::size_t size) { return AllocateOrThrow(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+#if defined(__cpp_aligned_new)
+// Over-aligned blocks keep the pointer returned by std::malloc just in
+// front of the aligned address.
+static void* AllocateAligned(const std::size_t size, const std::align_val_t alignment) noexcept {
+  const std::size_t align = static_cast<std::size_t>(alignment);
+  void* base = Allocate(size + align + sizeof(void*));
+  if (base == nullptr)
+    return nullptr;
+  const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(base) + sizeof(void*);
+  void** aligned = reinterpret_cast<void**>((address + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1));
+  aligned[-1] = base;
+  return aligned;
+}
+
+static void* AllocateAlignedOrThrow(const std::size_t size, const std::align_val_t alignment) {
+  void* ptr = AllocateAligned(size, alignment);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+static void FreeAligned(void* ptr) noexcept {
+  if (ptr != nullptr)
+    std::free(static_cast<void**>(ptr)[-1]);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+
+void* operator new[](std::size_t size, std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return AllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+
+void operator delete[](void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(ptr); }
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(ptr); }
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+#endif
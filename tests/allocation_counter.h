@@ -0,0 +1,29 @@
+/*
+ * allocation_counter.h
+ *
+ * Counts the heap allocations of the test binary. The global allocation
+ * functions are replaced in allocation_counter.cpp.
+ */
+
+#ifndef INICPP_TESTS_ALLOCATION_COUNTER_H_
+#define INICPP_TESTS_ALLOCATION_COUNTER_H_
+
+#include <cstddef>
+
+/** Counts the allocations made through operator new while it is alive. */
+class AllocationCounter {
+ public:
+  AllocationCounter();
+  ~AllocationCounter();
+
+  AllocationCounter(const AllocationCounter&) = delete;
+  AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+  /** Returns the number of allocations. */
+  std::size_t Count() const;
+
+  /** Returns the number of bytes that were requested. */
+  std::size_t Bytes() const;
+};
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * test_compiled.cpp
+ *
+ * Tests for compiled binary snapshots of ini files.
+ */
+
+#include "inicpp.h"
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef INICPP_HAS_MMAP
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+static void WriteFile(const char* file_name, const std::string& content) {
+  std::ofstream os(file_name, std::ios::binary);
+  os << content;
+}
+
+static std::string ReadFile(const char* file_name) {
+  std::ifstream is(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+TEST_CASE("compiled snapshot round trips a file", "Compiled") {
+  ini::IniFile inif;
+  inif["Foo"]["b"] = "multi\nline";
+  inif["Foo"]["a"] = 1;
+  inif["Bar"]["empty"] = "";
+  inif["Baz"];
+  inif.SaveCompiled("inicpp_compiled.bin");
+
+  ini::IniFile loaded;
+  loaded.LoadCompiled("inicpp_compiled.bin");
+  std::remove("inicpp_compiled.bin");
+
+  REQUIRE(loaded.size() == 3);
+  REQUIRE(loaded.Encode() == inif.Encode());
+}
+
+TEST_CASE("compiled snapshot is queried in place", "Compiled") {
+  ini::IniFile inif;
+  for (int i = 0; i < 100; ++i)
+    for (int j = 0; j < 10; ++j)
+      inif["Section" + std::to_string(i)]["key" + std::to_string(j)] = i * j;
+  inif.SaveCompiled("inicpp_compiled.bin");
+
+  ini::CompiledIni compiled;
+  REQUIRE(compiled.Open("inicpp_compiled.bin"));
+  std::remove("inicpp_compiled.bin");
+  REQUIRE(compiled.Verify());
+  REQUIRE(compiled.SectionCount() == 100);
+
+  ini::StringView value;
+  REQUIRE(compiled.Get("Section42", "key7", value));
+  REQUIRE(std::string(value) == "294");
+  REQUIRE_FALSE(compiled.Get("Section42", "key70", value));
+  REQUIRE_FALSE(compiled.Get("Section420", "key7", value));
+
+  const std::size_t npos = ini::CompiledIni::npos;
+  const std::size_t section = compiled.FindSection("Section5");
+  REQUIRE(section != npos);
+  REQUIRE(std::string(compiled.SectionName(section)) == "Section5");
+  REQUIRE(compiled.FieldCount(section) == 10);
+  REQUIRE(std::string(compiled.FieldName(section, 0)) == "key0");
+  REQUIRE(compiled.FindSection("Section") == npos);
+}
+
+TEST_CASE("compiled snapshot of a case insensitive file", "Compiled") {
+  ini::IniFileCaseInsensitive inif;
+  inif.Decode("[Foo]\nKey=1\n[bar]\nx=2\n");
+  inif.SaveCompiled("inicpp_compiled.bin");
+
+  ini::CompiledIniCaseInsensitive compiled;
+  REQUIRE(compiled.Open("inicpp_compiled.bin"));
+  ini::StringView value;
+  REQUIRE(compiled.Get("FOO", "key", value));
+  REQUIRE(std::string(value) == "1");
+  REQUIRE(compiled.Get("Bar", "X", value));
+
+  // the order of a case sensitive file differs
+  ini::CompiledIni sensitive;
+  REQUIRE_FALSE(sensitive.Open("inicpp_compiled.bin"));
+  std::remove("inicpp_compiled.bin");
+}
+
+TEST_CASE("corrupt compiled snapshot is rejected", "Compiled") {
+  ini::IniFile inif;
+  inif["Foo"]["a"] = "value";
+  inif.SaveCompiled("inicpp_compiled.bin");
+
+  std::string data = ReadFile("inicpp_compiled.bin");
+  data[data.size() - 1] = 'X';
+  WriteFile("inicpp_compiled.bin", data);
+  ini::CompiledIni compiled;
+  REQUIRE(compiled.Open("inicpp_compiled.bin"));
+  REQUIRE_FALSE(compiled.Verify());
+  REQUIRE_THROWS_AS(ini::IniFile().LoadCompiled("inicpp_compiled.bin"), std::runtime_error);
+
+  WriteFile("inicpp_compiled.bin", data.substr(0, data.size() - 1));
+  REQUIRE_FALSE(compiled.Open("inicpp_compiled.bin"));
+  WriteFile("inicpp_compiled.bin", "[Foo]\na=1\n");
+  REQUIRE_FALSE(compiled.Open("inicpp_compiled.bin"));
+  std::remove("inicpp_compiled.bin");
+  REQUIRE_FALSE(compiled.Open("inicpp_compiled.bin"));
+}
+
+TEST_CASE("compiled snapshot is rebuilt when the source changes", "Compiled") {
+  WriteFile("inicpp_source.ini", "[Foo]\na=1\n");
+  std::remove("inicpp_compiled.bin");
+
+  ini::IniFile inif;
+  inif.LoadCompiled("inicpp_compiled.bin", "inicpp_source.ini");
+  REQUIRE(inif["Foo"]["a"].As<int>() == 1);
+
+  ini::CompiledIni compiled;
+  REQUIRE(compiled.Open("inicpp_compiled.bin"));
+  REQUIRE(compiled.IsFresh("inicpp_source.ini"));
+
+  // same size, so only the hash reveals the change
+  WriteFile("inicpp_source.ini", "[Foo]\na=2\n");
+  REQUIRE_FALSE(compiled.IsFresh("inicpp_source.ini"));
+  inif.LoadCompiled("inicpp_compiled.bin", "inicpp_source.ini");
+  REQUIRE(inif["Foo"]["a"].As<int>() == 2);
+  REQUIRE(compiled.Open("inicpp_compiled.bin"));
+  REQUIRE(compiled.IsFresh("inicpp_source.ini"));
+
+  std::remove("inicpp_source.ini");
+  std::remove("inicpp_compiled.bin");
+}
+
+TEST_CASE("compiled snapshot is rebuilt for other parse options", "Compiled") {
+  WriteFile("inicpp_source.ini", "[Foo]\na:1\n");
+  std::remove("inicpp_compiled.bin");
+
+  ini::IniFile inif(':', {"#"});
+  inif.LoadCompiled("inicpp_compiled.bin", "inicpp_source.ini");
+  REQUIRE(inif["Foo"]["a"].As<int>() == 1);
+
+  ini::IniFile other;
+  REQUIRE_THROWS_AS(other.LoadCompiled("inicpp_compiled.bin"), std::runtime_error);
+
+  std::remove("inicpp_source.ini");
+  std::remove("inicpp_compiled.bin");
+}
+
+#ifdef INICPP_HAS_MMAP
+/** Returns the names of the entries of a directory, without "." and "..". */
+static std::vector<std::string> ListDirectory(const char* path) {
+  std::vector<std::string> names;
+  DIR* dir = ::opendir(path);
+  if (dir == nullptr)
+    return names;
+  while (const dirent* entry = ::readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name != "." && name != "..")
+      names.push_back(name);
+  }
+  ::closedir(dir);
+  return names;
+}
+
+TEST_CASE("compiled snapshot replaces the file without leaving temporary files", "Compiled") {
+  ::mkdir("inicpp_compiled_dir", 0755);
+  ini::IniFile inif;
+  inif["Foo"]["a"] = 1;
+  REQUIRE(inif.SaveCompiled("inicpp_compiled_dir/snapshot.bin"));
+  inif["Foo"]["a"] = 2;
+  REQUIRE(inif.SaveCompiled("inicpp_compiled_dir/snapshot.bin"));
+  REQUIRE(ListDirectory("inicpp_compiled_dir") == std::vector<std::string>(1, "snapshot.bin"));
+
+  ini::IniFile loaded;
+  loaded.LoadCompiled("inicpp_compiled_dir/snapshot.bin");
+  REQUIRE(loaded["Foo"]["a"].As<int>() == 2);
+  std::remove("inicpp_compiled_dir/snapshot.bin");
+  ::rmdir("inicpp_compiled_dir");
+}
+
+TEST_CASE("compiled snapshot that cannot be written keeps the target", "Compiled") {
+  // a directory cannot be replaced by a file
+  ::mkdir("inicpp_compiled_target", 0755);
+  WriteFile("inicpp_compiled_target/keep", "x");
+  ini::IniFile inif;
+  inif["Foo"]["a"] = 1;
+  REQUIRE_FALSE(inif.SaveCompiled("inicpp_compiled_target"));
+  REQUIRE(ReadFile("inicpp_compiled_target/keep") == "x");
+  REQUIRE_FALSE(inif.SaveCompiled("inicpp_missing_dir/snapshot.bin"));
+
+  std::vector<std::string> names = ListDirectory(".");
+  for (const std::string& name : names)
+    REQUIRE(name.find("inicpp_compiled_target.") == std::string::npos);
+  std::remove("inicpp_compiled_target/keep");
+  ::rmdir("inicpp_compiled_target");
+}
+#endif
@@ -0,0 +1,443 @@
+/*
+ * test_containers.cpp
+ *
+ * Tests for the container policies of ini::IniFileBase and ini::IniSectionBase.
+ */
+
+#include "inicpp.h"
+
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using MapIniFile = ini::IniFileBase<std::less<std::string>, ini::MapContainer>;
+using ArenaIniFile = ini::IniFileBase<std::less<std::string>, ini::ArenaMapContainer>;
+using FlatIniFile = ini::IniFileBase<std::less<std::string>, ini::FlatMapContainer>;
+using FlatIniFileCaseInsensitive = ini::IniFileBase<ini::StringInsensitiveLess, ini::FlatMapContainer>;
+using HashIniFile = ini::IniFileBase<std::less<std::string>, ini::HashMapContainer>;
+using HashIniFileCaseInsensitive = ini::IniFileBase<ini::StringInsensitiveLess, ini::HashMapContainer>;
+using InternedIniFile = ini::IniFileBase<ini::StringLess, ini::InternedMapContainer>;
+using OrderedIniFile = ini::IniFileBase<ini::StringLess, ini::OrderedMapContainer>;
+
+TEMPLATE_TEST_CASE("container policy decodes and encodes", "Containers", MapIniFile, ArenaIniFile, FlatIniFile,
+                   HashIniFile, InternedIniFile) {
+  TestType inif;
+  inif.Decode("[Foo]\nbar=1\nbaz=hello\n[Alpha]\nx=y");
+
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif["Foo"].size() == 2);
+  REQUIRE(inif["Foo"]["bar"].template As<int>() == 1);
+  REQUIRE(inif["Foo"]["baz"].template As<std::string>() == "hello");
+  REQUIRE(inif.Encode() == "[Alpha]\nx=y\n\n[Foo]\nbar=1\nbaz=hello\n\n");
+}
+
+TEMPLATE_TEST_CASE("container policy supports map operations", "Containers", MapIniFile, ArenaIniFile,
+                   FlatIniFile) {
+  TestType inif;
+  inif["B"]["k"] = 2;
+  inif["A"]["k"] = 1;
+
+  REQUIRE(inif.count("A") == 1);
+  REQUIRE(inif.find("C") == inif.end());
+  REQUIRE(inif.begin()->first == "A");
+
+  inif.erase("A");
+  REQUIRE(inif.size() == 1);
+
+  TestType copy(inif);
+  copy["B"]["k"] = 3;
+  REQUIRE(inif["B"]["k"].template As<int>() == 2);
+  REQUIRE(copy["B"]["k"].template As<int>() == 3);
+
+  TestType moved(std::move(copy));
+  REQUIRE(moved["B"]["k"].template As<int>() == 3);
+
+  inif = moved;
+  REQUIRE(inif["B"]["k"].template As<int>() == 3);
+
+  inif.clear();
+  REQUIRE(inif.empty());
+}
+
+TEST_CASE("arena reuses freed chunks", "Containers") {
+  ini::Arena arena;
+  void* first = arena.Allocate(48);
+  arena.Deallocate(first, 48);
+  REQUIRE(arena.Allocate(48) == first);
+  REQUIRE(arena.BlockCount() == 1);
+}
+
+TEST_CASE("arena grows by whole blocks", "Containers") {
+  ini::Arena arena;
+  for (int i = 0; i < 10000; ++i)
+    arena.Allocate(64);
+  // 640 kB in blocks doubling from 256 bytes up to 64 kB
+  REQUIRE(arena.BlockCount() < 20);
+}
+
+TEST_CASE("arena map container allocates the nodes of a file from one arena", "Containers") {
+  ArenaIniFile inif;
+  for (int i = 0; i < 1000; ++i)
+    inif["Section"]["key" + std::to_string(i)] = i;
+  inif["Other"]["key"] = 1;
+
+  const std::shared_ptr<ini::Arena> arena = inif.get_allocator().arena();
+  REQUIRE(inif["Section"].get_allocator().arena() == arena);
+  REQUIRE(inif["Other"].get_allocator().arena() == arena);
+  REQUIRE(arena->BlockCount() < 20);
+  REQUIRE(inif["Section"]["key999"].As<int>() == 999);
+
+  // a copy gets an arena of its own, shared by its sections
+  ArenaIniFile copy(inif);
+  REQUIRE(copy.get_allocator().arena() != arena);
+  REQUIRE(copy["Section"].get_allocator().arena() == copy.get_allocator().arena());
+  REQUIRE(copy["Section"]["key999"].As<int>() == 999);
+}
+
+TEST_CASE("arena map container sections can be modified from different threads", "Containers") {
+  ArenaIniFile inif;
+  const int thread_count = 4;
+  for (int t = 0; t < thread_count; ++t)
+    inif["Section" + std::to_string(t)]["seed"] = t;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    ini::IniSectionBase<std::less<std::string>, ini::ArenaMapContainer>& section =
+        inif["Section" + std::to_string(t)];
+    threads.emplace_back([&section]() {
+      for (int i = 0; i < 2000; ++i) {
+        section["key" + std::to_string(i)] = i;
+        if (i % 2 == 1)
+          section.erase("key" + std::to_string(i - 1));
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  for (int t = 0; t < thread_count; ++t) {
+    REQUIRE(inif["Section" + std::to_string(t)].size() == 1001);
+    REQUIRE(inif["Section" + std::to_string(t)]["key1999"].As<int>() == 1999);
+  }
+}
+
+template <typename File>
+static std::size_t CountDecodeBytes(const std::string& content) {
+  AllocationCounter counter;
+  File inif;
+  inif.Decode(content);
+  return counter.Bytes();
+}
+
+TEST_CASE("arena map container uses about as much memory as std::map", "Containers") {
+  std::string content;
+  for (int i = 0; i < 20000; ++i)
+    content += "[section" + std::to_string(i) + "]\na=1\nb=2\n";
+
+  const std::size_t map_bytes = CountDecodeBytes<MapIniFile>(content);
+  const std::size_t arena_bytes = CountDecodeBytes<ArenaIniFile>(content);
+  REQUIRE(arena_bytes < map_bytes + map_bytes / 8);
+}
+
+TEST_CASE("flat map keeps entries sorted", "Containers") {
+  ini::FlatMap<std::string, int, std::less<std::string>> map;
+  map["d"] = 4;
+  map["b"] = 2;
+  map["e"] = 5;
+  REQUIRE(map.insert(std::make_pair(std::string("a"), 1)).second);
+  REQUIRE_FALSE(map.insert(std::make_pair(std::string("b"), 7)).second);
+  REQUIRE(map.emplace("c", 3).second);
+
+  std::string keys;
+  int sum = 0;
+  for (const auto& pair : map) {
+    keys += pair.first;
+    sum += pair.second;
+  }
+  REQUIRE(keys == "abcde");
+  REQUIRE(sum == 15);
+
+  REQUIRE(map.lower_bound("bb")->first == "c");
+  REQUIRE(map.upper_bound("c")->first == "d");
+  REQUIRE(map.find("x") == map.end());
+  REQUIRE(map.at("e") == 5);
+  REQUIRE_THROWS_AS(map.at("x"), std::out_of_range);
+
+  REQUIRE(map.erase("c") == 1);
+  REQUIRE(map.erase("c") == 0);
+  map.erase(map.begin());
+  REQUIRE(map.size() == 3);
+  REQUIRE(map.begin()->first == "b");
+}
+
+TEST_CASE("flat map container decodes sections in any order", "Containers") {
+  FlatIniFileCaseInsensitive inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode("[zeta]\nb=1\n  more\na=2\n[Alpha]\nz=3\n[mid]\nk=4\n[ZETA]\nc=5\n");
+
+  REQUIRE(inif.size() == 3);
+  REQUIRE(inif.begin()->first == "Alpha");
+  REQUIRE(inif["Zeta"].size() == 3);
+  REQUIRE(inif["zeta"]["B"].As<std::string>() == "1\nmore");
+  REQUIRE(inif["zeta"].begin()->first == "a");
+  REQUIRE(inif["mid"]["k"].As<int>() == 4);
+}
+
+TEST_CASE("flat map container decodes lazily", "Containers") {
+  std::string content;
+  for (int i = 20; i > 0; --i)
+    content += "[s" + std::to_string(i) + "]\nv=" + std::to_string(i) + "\n";
+
+  FlatIniFile inif;
+  inif.DecodeLazy(content);
+  REQUIRE(inif["s7"]["v"].As<int>() == 7);
+
+  FlatIniFile eager;
+  eager.Decode(content);
+  REQUIRE(inif.Encode() == eager.Encode());
+}
+
+TEST_CASE("hash map finds, inserts and erases many keys", "Containers") {
+  ini::HashMap<std::string, int, std::less<std::string>> map;
+  for (int i = 0; i < 1000; ++i)
+    map["key" + std::to_string(i)] = i;
+  REQUIRE(map.size() == 1000);
+  REQUIRE_FALSE(map.emplace("key7", 70).second);
+  REQUIRE(map.at("key7") == 7);
+  REQUIRE_THROWS_AS(map.at("key1000"), std::out_of_range);
+
+  // erase every other key, the remaining ones must still be found
+  for (int i = 0; i < 1000; i += 2)
+    REQUIRE(map.erase("key" + std::to_string(i)) == 1);
+  REQUIRE(map.size() == 500);
+  for (int i = 0; i < 1000; ++i)
+    REQUIRE(map.count("key" + std::to_string(i)) == static_cast<std::size_t>(i % 2));
+
+  // reinserting reuses deleted slots
+  for (int i = 0; i < 1000; i += 2)
+    REQUIRE(map.insert(std::make_pair("key" + std::to_string(i), -i)).second);
+  REQUIRE(map.size() == 1000);
+  REQUIRE(map.find("key998")->second == -998);
+
+  int visited = 0;
+  for (auto it = map.begin(); it != map.end();) {
+    if (it->second < 0) {
+      it = map.erase(it);
+    } else {
+      ++visited;
+      ++it;
+    }
+  }
+  REQUIRE(visited == 501);
+  REQUIRE(map.size() == 501);
+}
+
+TEST_CASE("hash map container encodes in sorted order", "Containers") {
+  HashIniFile inif;
+  inif["b"]["z"] = 1;
+  inif["b"]["a"] = 2;
+  inif["a"]["k"] = 3;
+  REQUIRE(inif.begin()->first == "b");
+  REQUIRE(inif.Encode() == "[a]\nk=3\n\n[b]\na=2\nz=1\n\n");
+
+  HashIniFile copy(inif);
+  REQUIRE(copy["b"]["a"].As<int>() == 2);
+  copy.erase("b");
+  REQUIRE(copy.size() == 1);
+  REQUIRE(inif.size() == 2);
+}
+
+TEST_CASE("hash map container ignores case with the insensitive comparator", "Containers") {
+  HashIniFileCaseInsensitive inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode("[Foo]\nLong_Key_Name=1\n  more\n[FOO]\nother=2\n");
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif["foo"]["LONG_KEY_NAME"].As<std::string>() == "1\nmore");
+  REQUIRE(inif.at("fOo").at("OTHER").As<int>() == 2);
+  REQUIRE(ini::KeyTraits<ini::StringInsensitiveLess>::Hash("Long_Key_Name") ==
+          ini::KeyTraits<ini::StringInsensitiveLess>::Hash("long_key_name"));
+}
+
+TEST_CASE("intern pool stores equal strings once", "Containers") {
+  ini::InternPool pool;
+  const std::string& first = pool.Intern("a_name_longer_than_sso");
+  const std::string& second = pool.Intern(std::string("a_name_longer_than_sso"));
+  REQUIRE(&first == &second);
+  REQUIRE(&pool.Intern("other") != &first);
+  REQUIRE(pool.size() == 2);
+}
+
+TEST_CASE("intern pool finds strings while other threads add them", "Containers") {
+  ini::InternPool pool;
+  const std::string& first = pool.Intern("first_name");
+  // Catch assertions are not thread safe, the threads count failures
+  std::atomic<int> failures(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&pool, &first, &failures, t]() {
+      for (int i = 0; i < 2000; ++i) {
+        // all threads intern the same names, so they race on every one
+        const std::string name = "name_" + std::to_string(i);
+        const std::string& pooled = pool.Intern(name);
+        if (pooled != name || pool.Find(name) != &pooled || pool.Find("first_name") != &first)
+          ++failures;
+        if (t == 0 && pool.Find("missing_" + std::to_string(i)) != nullptr)
+          ++failures;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  REQUIRE(failures == 0);
+  REQUIRE(pool.size() == 2001);
+  REQUIRE(&pool.Intern("name_1999") == pool.Find("name_1999"));
+}
+
+TEST_CASE("interned map container shares names between files", "Containers") {
+  InternedIniFile first;
+  InternedIniFile second;
+  first.Decode("[shared_section_name]\nshared_field_name=1");
+  second.Decode("[shared_section_name]\nshared_field_name=2\nother=3");
+
+  const auto first_section = first.begin();
+  const auto second_section = second.begin();
+  REQUIRE(first_section->first == second_section->first);
+  REQUIRE(first_section->first.data() == second_section->first.data());
+  REQUIRE(first_section->second.begin()->first == second_section->second.find("shared_field_name")->first);
+  REQUIRE(first_section->first == "shared_section_name");
+  REQUIRE(second["shared_section_name"]["other"].As<int>() == 3);
+  REQUIRE(second.Encode() == "[shared_section_name]\nother=3\nshared_field_name=2\n\n");
+}
+
+TEST_CASE("interned map container shares values until they are written", "Containers") {
+  InternedIniFile first;
+  InternedIniFile second;
+  first.SetMultiLineValues(true);
+  first.Decode("[s]\nhost=shared.example.com\nlist=a\n  b\n");
+  second.Decode("[s]\nhost=shared.example.com\n");
+  REQUIRE(first["s"]["host"] == second["s"]["host"]);
+  REQUIRE(first["s"]["list"].As<std::string>() == "a\nb");
+
+  // writing copies the value, the other file keeps the pooled one
+  first["s"]["host"] = "private.example.com";
+  REQUIRE(first["s"]["host"].As<std::string>() == "private.example.com");
+  REQUIRE(second["s"]["host"].As<std::string>() == "shared.example.com");
+
+  InternedIniFile copy(first);
+  copy["s"]["host"] = 5;
+  REQUIRE(copy["s"]["host"].As<int>() == 5);
+  REQUIRE(first["s"]["host"].As<std::string>() == "private.example.com");
+  REQUIRE(copy.Encode() == "[s]\nhost=5\nlist=a\n\tb\n\n");
+  copy = second;
+  REQUIRE(copy == second);
+}
+
+TEST_CASE("interned map container decodes repeated files into map nodes only", "Containers") {
+  std::string content;
+  for (int sec = 0; sec < 20; ++sec) {
+    content += "[section_" + std::to_string(sec) + "]\n";
+    for (int field = 0; field < 10; ++field)
+      content += "attribute_" + std::to_string(field) + " = a value longer than the inline buffer\n";
+  }
+  InternedIniFile first;
+  first.Decode(content);
+
+  std::size_t interned;
+  {
+    InternedIniFile second;
+    AllocationCounter counter;
+    second.Decode(content);
+    interned = counter.Count();
+  }
+  std::size_t plain;
+  {
+    MapIniFile inif;
+    AllocationCounter counter;
+    inif.Decode(content);
+    plain = counter.Count();
+  }
+  // one map node per section and field, names and values are pooled
+  REQUIRE(interned == 20 + 20 * 10);
+  REQUIRE(plain > interned);
+}
+
+struct TestInternPool {
+  static ini::InternPool& Get() {
+    static ini::InternPool pool;
+    return pool;
+  }
+};
+
+TEST_CASE("interned map container looks up names without interning them", "Containers") {
+  using PoolIniFile = ini::IniFileBase<ini::StringLess, ini::BasicInternedMapContainer<TestInternPool>>;
+  PoolIniFile inif;
+  inif.Decode("[B]\nk=2\n[A]\nk=1\nother=3");
+  // the names B, k, A and other and the values 2, 1 and 3
+  const std::size_t pooled = TestInternPool::Get().size();
+  REQUIRE(pooled == 7);
+
+  REQUIRE(inif.count("A") == 1);
+  REQUIRE(inif.count(std::string("C")) == 0);
+  REQUIRE(inif.find("missing_section") == inif.end());
+  REQUIRE(inif["A"].find(std::string("missing_field")) == inif["A"].end());
+  REQUIRE_FALSE(inif.contains("also_missing"));
+  REQUIRE_THROWS_AS(inif.at("nope"), std::out_of_range);
+  REQUIRE_THROWS_AS(inif.at(std::string("A")).at("nope"), std::out_of_range);
+  REQUIRE(inif.at(std::string("A")).at(std::string("other")).As<int>() == 3);
+  REQUIRE(TestInternPool::Get().size() == pooled);
+  REQUIRE(ini::InternPool::Global().Find("missing_section") == nullptr);
+
+  inif.erase("A");
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif.Encode() == "[B]\nk=2\n\n");
+}
+
+TEST_CASE("case insensitive interned map container compares by content", "Containers") {
+  ini::IniFileBase<ini::StringInsensitiveLess, ini::InternedMapContainer> inif;
+  inif.Decode("[Foo]\nBar=1\n[alpha]\nx=2");
+  REQUIRE(inif.begin()->first == "alpha");
+  REQUIRE(inif.at("FOO").at("bar").As<int>() == 1);
+  REQUIRE(inif.count(std::string("ALPHA")) == 1);
+}
+
+TEST_CASE("ordered map container keeps the order of the file", "Containers") {
+  OrderedIniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode("[zeta]\nb=1\na=2\n[alpha]\ny=3\n  more\nx=4\n[zeta]\nc=5\n");
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif.begin()->first == "zeta");
+  REQUIRE(inif["alpha"]["y"].As<std::string>() == "3\nmore");
+  REQUIRE(inif.Encode() == "[zeta]\nb=1\na=2\nc=5\n\n[alpha]\ny=3\n\tmore\nx=4\n\n");
+
+  // appended entries go last, erasing keeps the order of the others
+  inif["beta"]["k"] = 6;
+  inif["zeta"].erase("b");
+  inif.erase("alpha");
+  REQUIRE(inif.Encode() == "[zeta]\na=2\nc=5\n\n[beta]\nk=6\n\n");
+  REQUIRE(inif.at("beta").at("k").As<int>() == 6);
+}
+
+TEST_CASE("ordered hash map finds keys after erasing in the middle", "Containers") {
+  ini::HashMap<std::string, int, ini::StringLess, true> map;
+  for (int i = 0; i < 200; ++i)
+    map[std::to_string(i)] = i;
+  for (int i = 0; i < 200; i += 3)
+    REQUIRE(map.erase(std::to_string(i)) == 1);
+
+  int previous = -1;
+  for (const auto& entry : map) {
+    REQUIRE(entry.second % 3 != 0);
+    REQUIRE(entry.second > previous);
+    previous = entry.second;
+  }
+  for (int i = 0; i < 200; ++i) {
+    const auto it = map.find(std::to_string(i));
+    REQUIRE((it == map.end()) == (i % 3 == 0));
+    if (it != map.end())
+      REQUIRE(it->second == i);
+  }
+}
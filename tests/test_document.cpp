@@ -0,0 +1,244 @@
+/*
+ * test_document.cpp
+ *
+ * Tests for ini::IniDocument, the lossless document with in-place edits.
+ */
+
+#include "inicpp.h"
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char* kDocumentText =
+    "# global settings\n"
+    "[net]\n"
+    "  port = 80   ; http\n"
+    "host=example.org\n"
+    "\n"
+    "; tuning\n"
+    "[limits]\n"
+    "max_conns=100\n";
+
+static std::string ReadFile(const std::string& file_name) {
+  std::ifstream is(file_name.c_str(), std::ios::binary);
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+static void WriteFile(const std::string& file_name, const std::string& text) {
+  std::ofstream os(file_name.c_str(), std::ios::binary | std::ios::trunc);
+  os << text;
+}
+
+TEST_CASE("document encodes its text unchanged", "IniDocument") {
+  ini::IniDocument doc;
+  doc.Decode(kDocumentText);
+  REQUIRE(doc.Encode() == kDocumentText);
+  REQUIRE(doc.Get("net", "port").As<int>() == 80);
+  REQUIRE(doc.Get("limits", "max_conns").As<int>() == 100);
+  REQUIRE(doc.Contains("net", "host"));
+  REQUIRE_FALSE(doc.Contains("net", "missing"));
+  REQUIRE_THROWS_AS(doc.Get("net", "missing"), std::out_of_range);
+}
+
+TEST_CASE("document edits only the changed values", "IniDocument") {
+  ini::IniDocument doc;
+  doc.Decode(kDocumentText);
+  doc.Set("net", "port", 8080);
+  doc.Set("limits", "max_conns", std::string("5"));
+
+  REQUIRE(doc.PendingEdits() == 2);
+  REQUIRE(doc.Get("net", "port").As<int>() == 8080);
+  REQUIRE(doc.Encode() ==
+          "# global settings\n"
+          "[net]\n"
+          "  port = 8080   ; http\n"
+          "host=example.org\n"
+          "\n"
+          "; tuning\n"
+          "[limits]\n"
+          "max_conns=5\n");
+  // the decoded text is kept until the document is saved
+  REQUIRE(doc.Text() == kDocumentText);
+}
+
+TEST_CASE("document adds fields after their section and new sections at the end", "IniDocument") {
+  ini::IniDocument doc;
+  doc.Decode("[a]\nx=1\n\n# comment\n[b]\ny=2");
+  doc.Set("a", "z", 3);
+  doc.Set("b", "w", 4);
+  doc.Set("c", "v", 5);
+  REQUIRE(doc.Encode() == "[a]\nx=1\nz=3\n\n# comment\n[b]\ny=2\nw=4\n\n[c]\nv=5\n");
+
+  ini::IniFile inif;
+  inif.Decode(doc.Encode());
+  REQUIRE(inif["b"]["w"].As<int>() == 4);
+  REQUIRE(inif["c"]["v"].As<int>() == 5);
+}
+
+TEST_CASE("document locates values of lines with escaped comment prefixes", "IniDocument") {
+  ini::IniDocument doc;
+  doc.Decode("[a]\nurl = http://x/\\#top # anchor\nnext=1\n");
+  REQUIRE(doc.Get("a", "url").As<std::string>() == "http://x/#top");
+
+  doc.Set("a", "url", std::string("y#1"));
+  REQUIRE(doc.Encode() == "[a]\nurl = y\\#1 # anchor\nnext=1\n");
+}
+
+TEST_CASE("document keeps comments that directly follow a value", "IniDocument") {
+  ini::IniDocument doc;
+  doc.Decode("[s]\nk=#c\n");
+  doc.Set("s", "k", std::string("x\\"));
+  REQUIRE(doc.Encode() == "[s]\nk=x\\ #c\n");
+
+  ini::IniFile inif;
+  inif.Decode(doc.Encode());
+  REQUIRE(inif["s"]["k"].As<std::string>() == "x\\");
+}
+
+TEST_CASE("document edits decode to the values that were set", "IniDocument") {
+  const std::vector<std::string> texts = {"[s]\nk=#c\n", "[s]\nk=a;c\nz=1\n", "[s]\nk=//c\n", "[s]\nk = b // c\n",
+                                          "[s]\nk=\n"};
+  const std::vector<std::string> values = {"", "x\\", "x/", "a;b", "y#", "\\/", "//", "v"};
+  for (const std::vector<std::string>& prefixes :
+       {std::vector<std::string>{"#", ";"}, std::vector<std::string>{"//", ";"}}) {
+    for (const std::string& text : texts) {
+      for (const std::string& value : values) {
+        ini::IniDocument doc;
+        doc.SetCommentPrefixes(prefixes);
+        doc.Decode(text);
+        doc.Set("s", "k", value);
+        doc.Set("s", "added", value);
+
+        ini::IniFile inif;
+        inif.SetCommentPrefixes(prefixes);
+        inif.Decode(doc.Encode());
+        REQUIRE(inif["s"]["k"].As<std::string>() == value);
+        REQUIRE(inif["s"]["added"].As<std::string>() == value);
+      }
+    }
+  }
+}
+
+TEST_CASE("document replaces multi-line values", "IniDocument") {
+  ini::IniDocument doc;
+  doc.SetMultiLineValues(true);
+  doc.Decode("[a]\nlist=one\n  two\n  three\nafter=1\n");
+  REQUIRE(doc.Get("a", "list").As<std::string>() == "one\ntwo\nthree");
+
+  doc.Set("a", "list", std::string("1\n2"));
+  REQUIRE(doc.Encode() == "[a]\nlist=1\n\t2\nafter=1\n");
+}
+
+TEST_CASE("document keeps comments between the lines of a multi-line value", "IniDocument") {
+  ini::IniDocument doc;
+  doc.SetMultiLineValues(true);
+  doc.Decode("[s]\nk=a ; note A\n# interior comment\n  b ; note B\n  c\nz=1\n");
+  REQUIRE(doc.Get("s", "k").As<std::string>() == "a\nb\nc");
+
+  doc.Set("s", "k", std::string("x"));
+  const std::string text = doc.Encode();
+  REQUIRE(text == "[s]\nk=x ; note A\n# interior comment\n   ; note B\nz=1\n");
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode(text);
+  REQUIRE(inif["s"]["k"].As<std::string>() == "x");
+  REQUIRE(inif["s"]["z"].As<int>() == 1);
+}
+
+TEST_CASE("document saves a shorter multi-line value in place", "IniDocument") {
+  const char* file_name = "inicpp_document_multi_line.ini";
+  const std::string original = "[s]\nk=abc ; note\n  def\n  ghi ; tail\nz=1\n";
+  WriteFile(file_name, original);
+
+  ini::IniDocument doc;
+  doc.SetMultiLineValues(true);
+  doc.Load(file_name);
+  doc.Set("s", "k", std::string("x"));
+  REQUIRE(doc.Save());
+  const std::string saved = ReadFile(file_name);
+  REQUIRE(saved.size() == original.size());
+  REQUIRE(saved == doc.Text());
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode(saved);
+  REQUIRE(inif["s"]["k"].As<std::string>() == "x");
+  REQUIRE(saved.find("; note\n") != std::string::npos);
+  REQUIRE(saved.find("; tail\n") != std::string::npos);
+
+  // the blanked lines are not removed a second time
+  doc.Set("s", "k", std::string("y"));
+  REQUIRE(doc.Save());
+  REQUIRE(ReadFile(file_name).find("k=y   ; note\n") != std::string::npos);
+  std::remove(file_name);
+}
+
+TEST_CASE("document saves edits that fit in place", "IniDocument") {
+  const char* file_name = "inicpp_document.ini";
+  WriteFile(file_name, kDocumentText);
+
+  ini::IniDocument doc;
+  doc.Load(file_name);
+  doc.Set("net", "port", 8);
+  doc.Set("net", "host", std::string("example.com"));
+  doc.Save();
+
+  REQUIRE(doc.PendingEdits() == 0);
+  const std::string saved = ReadFile(file_name);
+  REQUIRE(saved.size() == std::string(kDocumentText).size());
+  REQUIRE(saved == doc.Text());
+  ini::IniFile inif(file_name);
+  REQUIRE(inif["net"]["port"].As<int>() == 8);
+  REQUIRE(inif["net"]["host"].As<std::string>() == "example.com");
+  REQUIRE(saved.find("  port = 8    ; http\n") != std::string::npos);
+
+  // a value that does not fit rewrites the file
+  doc.Set("net", "port", 65535);
+  doc.Save();
+  REQUIRE(ReadFile(file_name) == doc.Text());
+  REQUIRE(doc.Text().find("  port = 65535    ; http\n") != std::string::npos);
+  REQUIRE(doc.Get("net", "port").As<int>() == 65535);
+
+  std::remove(file_name);
+}
+
+TEST_CASE("document rewrites a file that changed since it was loaded", "IniDocument") {
+  const char* file_name = "inicpp_document_changed.ini";
+  WriteFile(file_name, "[a]\nx=10\n");
+
+  ini::IniDocument doc;
+  doc.Load(file_name);
+  WriteFile(file_name, "[a]\nx=10\ny=2\n");
+  doc.Set("a", "x", 1);
+  doc.Save();
+  REQUIRE(ReadFile(file_name) == "[a]\nx=1\n");
+
+  std::remove(file_name);
+}
+
+TEST_CASE("document keeps its edits if the file cannot be written", "IniDocument") {
+  ini::IniDocument doc;
+  doc.Decode(kDocumentText);
+  doc.Set("net", "port", 8080);
+  REQUIRE_FALSE(doc.Save("inicpp_missing_dir/document.ini"));
+  REQUIRE(doc.Text() == kDocumentText);
+  REQUIRE(doc.PendingEdits() == 1);
+  REQUIRE(doc.Get("net", "port").As<int>() == 8080);
+
+  const char* file_name = "inicpp_document_saved.ini";
+  REQUIRE(doc.Save(file_name));
+  REQUIRE(doc.PendingEdits() == 0);
+  REQUIRE(ReadFile(file_name) == doc.Text());
+  std::remove(file_name);
+}
+
+TEST_CASE("document reports malformed text", "IniDocument") {
+  ini::IniDocument doc;
+  REQUIRE_THROWS_AS(doc.Decode("[a]\nno separator\n"), std::logic_error);
+  REQUIRE_THROWS_AS(doc.Save(), std::logic_error);
+}
@@ -210,6 +210,30 @@ TEST_CASE("custom escape character", "EdgeCase") {
   REQUIRE(inif["Sec"]["val"].As<std::string>() == "hello # world");
 }
 
+TEST_CASE("escaped comment prefixes mixed with plain escape chars", "EdgeCase") {
+  ini::IniFile inif;
+  inif.Decode("[Sec]\nk=a\\\\#b\\c\\;d;e\nl=x\\#y#z");
+
+  // "\\#" keeps one backslash and the prefix, a lone backslash is kept
+  REQUIRE(inif["Sec"]["k"].As<std::string>() == "a\\#b\\c;d");
+  REQUIRE(inif["Sec"]["l"].As<std::string>() == "x#y");
+}
+
+TEST_CASE("stripping many escaped comment prefixes keeps every prefix", "EdgeCase") {
+  const std::size_t count = 100000;
+  std::string line = "[Sec]\nkey=";
+  for (std::size_t i = 0; i < count; ++i)
+    line += (i % 2 == 0) ? "\\#" : "\\;";
+  line += " # trailing comment";
+
+  ini::IniFile inif;
+  inif.Decode(line);
+
+  const std::string value = inif["Sec"]["key"].As<std::string>();
+  REQUIRE(value.size() == count);
+  REQUIRE(value.find_first_not_of("#;") == std::string::npos);
+}
+
 /***************************************************
  *          Multi-line Values
  ***************************************************/
@@ -223,6 +247,23 @@ TEST_CASE("multi-line value with multiple continuation lines", "EdgeCase") {
   REQUIRE(inif["Sec"]["text"].As<std::string>() == "line1\nline2\nline3\nline4");
 }
 
+TEST_CASE("multi-line value with 10k continuation lines", "EdgeCase") {
+  std::string content = "[Sec]\nsql = SELECT\n";
+  std::string expected = "SELECT";
+  for (int i = 0; i < 10000; ++i) {
+    const std::string column = "col" + std::to_string(i) + ",";
+    content += "    " + column + "\n";
+    expected += "\n" + column;
+  }
+  content += "next = 1\n";
+
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode(content);
+  REQUIRE(inif["Sec"]["sql"].As<std::string>() == expected);
+  REQUIRE(inif["Sec"]["next"].As<int>() == 1);
+}
+
 TEST_CASE("multi-line value encode produces continuation with tab", "EdgeCase") {
   ini::IniFile inif;
   inif.SetMultiLineValues(true);
@@ -8,9 +8,12 @@
 
 #include <cstdio>
 
+#include <atomic>
 #include <catch2/catch.hpp>
 #include <fstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 static const char* kTempFile = "test_inifile_tmp.ini";
 
@@ -150,3 +153,192 @@ TEST_CASE("load multiple times clears previous content", "FileIO") {
 
   RemoveTempFile();
 }
+
+TEST_CASE("load nonexistent file yields empty ini", "FileIO") {
+  ini::IniFile inif;
+  inif["Old"]["data"] = "old_value";
+  inif.Load("this_file_does_not_exist.ini");
+  REQUIRE(inif.size() == 0);
+}
+
+TEST_CASE("load file without trailing newline and with CRLF line endings", "FileIO") {
+  WriteTempFile("[Win]\r\nkey = value \r\nother=1 # comment\r\nlast=end");
+
+  ini::IniFile inif;
+  inif.Load(kTempFile);
+  REQUIRE(inif["Win"]["key"].As<std::string>() == "value");
+  REQUIRE(inif["Win"]["other"].As<int>() == 1);
+  REQUIRE(inif["Win"]["last"].As<std::string>() == "end");
+
+  RemoveTempFile();
+}
+
+TEST_CASE("load large file through mapped path", "FileIO") {
+  std::string content;
+  for (int sec = 0; sec < 100; ++sec) {
+    content += "[Section" + std::to_string(sec) + "]\n";
+    for (int key = 0; key < 100; ++key)
+      content += "key" + std::to_string(key) + "=" + std::to_string(sec * key) + "\n";
+  }
+  WriteTempFile(content);
+
+  ini::IniFile inif;
+  inif.LoadMapped(kTempFile);
+  REQUIRE(inif.size() == 100);
+  REQUIRE(inif["Section42"].size() == 100);
+  REQUIRE(inif["Section42"]["key7"].As<int>() == 294);
+  REQUIRE(inif["Section99"]["key99"].As<int>() == 9801);
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kUnchanged);
+
+  ini::IniFile read;
+  read.Load(kTempFile);
+  REQUIRE(read.Encode() == inif.Encode());
+
+  RemoveTempFile();
+}
+
+TEST_CASE("decode from character buffer", "FileIO") {
+  const char buffer[] = "[Foo]\nbar=bla\n[Baz]\nqux=1";
+
+  ini::IniFile inif;
+  inif.Decode(buffer, sizeof(buffer) - 1);
+  REQUIRE(inif["Foo"]["bar"].As<std::string>() == "bla");
+  REQUIRE(inif["Baz"]["qux"].As<int>() == 1);
+}
+
+TEST_CASE("reload if changed skips unchanged files", "IniFile") {
+  const char* file_name = "inicpp_reload.ini";
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=1\n";
+  }
+  ini::IniFile inif;
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kMissing);
+  inif.Load(file_name);
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kUnchanged);
+  const auto handle = inif.Resolve("Foo", "a");
+  REQUIRE(handle.As<int>() == 1);
+
+  // same size, only the contents reveal the change
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=2\n";
+  }
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kChanged);
+  REQUIRE(inif["Foo"]["a"].As<int>() == 2);
+  REQUIRE(handle.As<int>() == 2);
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kUnchanged);
+
+  // formatting changes decode to the same contents
+  {
+    std::ofstream os(file_name);
+    os << "# comment\n[Foo]\n  a = 2\n";
+  }
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kSameContents);
+  REQUIRE(inif["Foo"]["a"].As<int>() == 2);
+
+  std::remove(file_name);
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kMissing);
+  REQUIRE(inif["Foo"]["a"].As<int>() == 2);
+}
+
+TEST_CASE("reload if changed keeps the contents on errors", "IniFile") {
+  const char* file_name = "inicpp_reload.ini";
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=1\n";
+  }
+  ini::IniFile inif;
+  inif.Load(file_name);
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\nbroken\n";
+  }
+  REQUIRE_THROWS_AS(inif.ReloadIfChanged(), std::logic_error);
+  REQUIRE(inif["Foo"]["a"].As<int>() == 1);
+  std::remove(file_name);
+}
+
+/** Truncates and rewrites the given file in chunks until stop is set.
+ * Every prefix of the contents decodes without errors. */
+static void RewriteFileUntil(const char* file_name, const std::atomic<bool>& stop) {
+  const std::string chunk(65536, '#');
+  while (!stop.load()) {
+    std::ofstream os(file_name, std::ios::binary | std::ios::trunc);
+    for (int i = 0; i < 32 && !stop.load(); ++i) {
+      os << chunk << '\n';
+      os.flush();
+    }
+  }
+}
+
+TEST_CASE("reload if changed survives a file truncated while it is read", "IniFile") {
+  const char* file_name = "inicpp_reload_truncate.ini";
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=1\n";
+  }
+  ini::IniFile inif;
+  inif.Load(file_name);
+
+  std::atomic<bool> stop(false);
+  std::thread writer(RewriteFileUntil, file_name, std::cref(stop));
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+  int reloads = 0;
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (inif.ReloadIfChanged() == ini::ReloadResult::kChanged)
+      ++reloads;
+  }
+  stop.store(true);
+  writer.join();
+  std::remove(file_name);
+  REQUIRE(reloads > 0);
+}
+
+TEST_CASE("decode forgets the file of the last load", "IniFile") {
+  const char* file_name = "inicpp_reload.ini";
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=1\n";
+  }
+  ini::IniFile inif;
+  inif.Load(file_name);
+  inif.Decode("[Bar]\nb=2\n");
+  REQUIRE(inif.ReloadIfChanged() == ini::ReloadResult::kMissing);
+  std::remove(file_name);
+}
+
+TEST_CASE("reload if changed keeps the options of every loader", "IniFile") {
+  const char* file_name = "inicpp_reload.ini";
+  const char* snapshot_name = "inicpp_reload.ini.bin";
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=1\n[Bar]\nb=1\n";
+  }
+  ini::IniFile filtered;
+  filtered.Load(file_name, std::vector<std::string>{"Foo"});
+  ini::IniFile parallel;
+  parallel.LoadParallel(file_name, 2);
+  ini::IniFile lazy;
+  lazy.LoadLazy(file_name);
+  ini::IniFile compiled;
+  compiled.LoadCompiled(snapshot_name, file_name);
+  ini::IniFile from_snapshot;
+  from_snapshot.LoadCompiled(snapshot_name, file_name);
+  for (ini::IniFile* inif : {&filtered, &parallel, &lazy, &compiled, &from_snapshot})
+    REQUIRE(inif->ReloadIfChanged() == ini::ReloadResult::kUnchanged);
+
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\na=2\n[Bar]\nb=2\n";
+  }
+  for (ini::IniFile* inif : {&filtered, &parallel, &lazy, &compiled, &from_snapshot}) {
+    REQUIRE(inif->ReloadIfChanged() == ini::ReloadResult::kChanged);
+    REQUIRE((*inif)["Foo"]["a"].As<int>() == 2);
+  }
+  REQUIRE(filtered.find("Bar") == filtered.end());
+  REQUIRE(parallel["Bar"]["b"].As<int>() == 2);
+  REQUIRE(lazy["Bar"]["b"].As<int>() == 2);
+  std::remove(file_name);
+  std::remove(snapshot_name);
+}
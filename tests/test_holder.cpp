@@ -0,0 +1,75 @@
+/*
+ * test_holder.cpp
+ *
+ * Tests for publishing ini file snapshots to concurrent readers.
+ */
+
+#include "inicpp.h"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+static ini::IniFile MakeFile(const int version) {
+  ini::IniFile inif;
+  inif["Foo"]["a"] = version;
+  inif["Foo"]["b"] = version;
+  return inif;
+}
+
+TEST_CASE("holder starts with an empty file", "IniHolder") {
+  ini::IniHolder holder;
+  ini::IniHolder::Reader reader(holder);
+  REQUIRE(reader.Get().empty());
+  REQUIRE(holder.Version() == 0);
+}
+
+TEST_CASE("reader keeps its snapshot until the next get", "IniHolder") {
+  ini::IniHolder holder(std::make_shared<ini::IniFile>(MakeFile(1)));
+  ini::IniHolder::Reader reader(holder);
+  const ini::IniFile& first = reader.Get();
+  REQUIRE(first.at("Foo").at("a").As<int>() == 1);
+
+  holder.Publish(MakeFile(2));
+  REQUIRE(holder.Version() == 1);
+  REQUIRE(first.at("Foo").at("a").As<int>() == 1);
+  REQUIRE(holder.Current()->at("Foo").at("a").As<int>() == 2);
+
+  const ini::IniFile& second = reader.Get();
+  REQUIRE(second.at("Foo").at("a").As<int>() == 2);
+  REQUIRE(reader.Version() == 1);
+}
+
+TEST_CASE("concurrent readers see consistent snapshots", "IniHolder") {
+  ini::IniHolder holder(std::make_shared<ini::IniFile>(MakeFile(0)));
+  std::atomic<bool> done(false);
+  std::atomic<int> inconsistent(0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      ini::IniHolder::Reader reader(holder);
+      int last = 0;
+      while (!done.load()) {
+        const ini::IniFile& inif = reader.Get();
+        const int a = inif.at("Foo").at("a").As<int>();
+        const int b = inif.at("Foo").at("b").As<int>();
+        if (a != b || a < last)
+          ++inconsistent;
+        last = a;
+      }
+    });
+  }
+
+  for (int version = 1; version <= 200; ++version)
+    holder.Publish(MakeFile(version));
+  done = true;
+  for (std::thread& reader : readers)
+    reader.join();
+
+  REQUIRE(inconsistent.load() == 0);
+  REQUIRE(holder.Version() == 200);
+  REQUIRE(ini::IniHolder::Reader(holder).Get().at("Foo").at("a").As<int>() == 200);
+}
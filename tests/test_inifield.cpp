@@ -6,7 +6,10 @@
 
 #include "inicpp.h"
 
+#include <atomic>
 #include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
 
 TEST_CASE("IniField default constructor creates empty field", "IniField") {
   ini::IniField field;
@@ -85,3 +88,69 @@ TEST_CASE("IniField overwrite preserves latest value", "IniField") {
   field = "now a string";
   REQUIRE(field.As<std::string>() == "now a string");
 }
+
+TEST_CASE("IniField caches typed reads until it is assigned", "IniField") {
+  ini::IniField field("0x10");
+  REQUIRE(field.As<int>() == 16);
+  REQUIRE(field.As<int>() == 16);
+  // other types are decoded from the string, not from the cache
+  REQUIRE(field.As<long>() == 16);
+  REQUIRE(field.As<std::string>() == "0x10");
+
+  ini::IniField copy(field);
+  REQUIRE(copy.As<int>() == 16);
+
+  field = 7;
+  REQUIRE(field.As<int>() == 7);
+  field = ini::IniField("8");
+  REQUIRE(field.As<int>() == 8);
+  REQUIRE(copy.As<int>() == 16);
+}
+
+TEST_CASE("IniField caches the type it was read as last", "IniField") {
+  const ini::IniField field("12");
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE(field.As<int>() == 12);
+    REQUIRE(field.As<double>() == 12.0);
+    REQUIRE(field.As<unsigned short>() == 12);
+  }
+}
+
+TEST_CASE("IniField reads the same values from several threads", "IniField") {
+  const ini::IniField field("1000");
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&field, &failures, t]() {
+      for (int i = 0; i < 20000; ++i) {
+        // readers alternate types, so the cached value keeps being replaced
+        const bool ok = (i + t) % 2 == 0 ? field.As<int>() == 1000 : field.As<double>() == 1000.0;
+        if (!ok)
+          ++failures;
+      }
+    });
+  }
+  for (std::thread& reader : readers)
+    reader.join();
+  REQUIRE(failures.load() == 0);
+}
+
+TEST_CASE("IniField is as large as its value unless the cache is enabled", "IniField") {
+#ifdef INICPP_FIELD_CACHE
+  STATIC_REQUIRE(sizeof(ini::IniField) > sizeof(std::string));
+#else
+  STATIC_REQUIRE(sizeof(ini::IniField) == sizeof(std::string));
+#endif
+}
+
+TEST_CASE("IniFile fields are re-read after decoding again", "IniField") {
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode("[Foo]\nbar=1\nbaz=true");
+  REQUIRE(inif["Foo"]["bar"].As<int>() == 1);
+  REQUIRE(inif["Foo"]["baz"].As<bool>());
+
+  inif.Decode("[Foo]\nbar=2\nbaz=false");
+  REQUIRE(inif["Foo"]["bar"].As<int>() == 2);
+  REQUIRE_FALSE(inif["Foo"]["baz"].As<bool>());
+}
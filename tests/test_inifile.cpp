@@ -673,6 +673,50 @@ TEST_CASE("stringInsensitiveLess operator() has a case insensitive strict weak o
   REQUIRE(cc("B", "a") == false);
 }
 
+TEST_CASE("stringInsensitiveLess operator() compares long keys", "StringInsensitiveLessFunctor") {
+  ini::StringInsensitiveLess cc;
+  const std::string prefix = "Some_Rather_Long_Section_Name_";
+
+  REQUIRE_FALSE(cc(prefix + "ABC", "some_rather_long_section_name_abc"));
+  REQUIRE_FALSE(cc("some_rather_long_section_name_abc", prefix + "ABC"));
+  REQUIRE(cc(prefix + "abc", prefix + "ABD"));
+  REQUIRE(cc(prefix, prefix + "x"));
+  REQUIRE(cc(prefix + "[", prefix + "_"));
+  REQUIRE(cc(prefix + "[", prefix + "Z"));
+}
+
+TEST_CASE("stringInsensitiveLess operator() agrees with comparing lower case copies",
+          "StringInsensitiveLessFunctor") {
+  ini::StringInsensitiveLess cc;
+  const std::string alphabet = "aAbBzZ@[`{_09\xc4\xe4";
+  auto lower = [](std::string str) {
+    for (char& c : str) {
+      if (c >= 'A' && c <= 'Z')
+        c = static_cast<char>(c - 'A' + 'a');
+    }
+    return str;
+  };
+
+  unsigned seed = 1;
+  auto next = [&seed]() {
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 16) & 0x7fff;
+  };
+  for (int i = 0; i < 2000; ++i) {
+    std::string lhs(next() % 40, 'a');
+    for (char& c : lhs)
+      c = alphabet[next() % alphabet.size()];
+    std::string rhs = lhs;
+    if (!rhs.empty())
+      rhs[next() % rhs.size()] = alphabet[next() % alphabet.size()];
+    if (next() % 4 == 0)
+      rhs += alphabet[next() % alphabet.size()];
+
+    REQUIRE(cc(lhs, rhs) == (lower(lhs) < lower(rhs)));
+    REQUIRE(cc(rhs, lhs) == (lower(rhs) < lower(lhs)));
+  }
+}
+
 TEST_CASE("default inifile parser is case sensitive", "IniFile") {
   std::istringstream ss("[FOO]\nbar=bla");
   ini::IniFile inif(ss);
@@ -843,3 +887,85 @@ TEST_CASE("parse section with duplicate field and overwriteDuplicateFields_ set
   REQUIRE_THROWS(inif.Decode("[Foo]\nbar=hello\nbar=world"));
 }
 #endif
+
+TEST_CASE("resolved handle reads a field without lookups", "IniFile") {
+  ini::IniFile inif;
+  inif.Decode("[net]\nport=80");
+  const auto handle = inif.Resolve("net", "port");
+  const auto missing = inif.Resolve("net", "host");
+
+  REQUIRE(handle.As<int>() == 80);
+  REQUIRE(handle.Find() == &inif["net"]["port"]);
+  REQUIRE_FALSE(missing.Exists());
+  REQUIRE_THROWS_AS(missing.Get(), std::out_of_range);
+
+  // fields assigned in place are seen without resolving again
+  inif["net"]["port"] = 8080;
+  REQUIRE(handle.As<int>() == 8080);
+
+  // a new decode changes the generation, the handle resolves again
+  const std::uint64_t generation = inif.Generation();
+  inif.Decode("[net]\nhost=localhost\nport=443");
+  REQUIRE(inif.Generation() != generation);
+  REQUIRE(handle.As<int>() == 443);
+  REQUIRE(missing.As<std::string>() == "localhost");
+
+  inif.clear();
+  REQUIRE_FALSE(handle.Exists());
+}
+
+TEST_CASE("resolved handle follows assignments and invalidation", "IniFile") {
+  ini::IniFile inif;
+  inif.Decode("[net]\nport=80");
+  const auto handle = inif.Resolve("net", "port");
+  REQUIRE(handle.As<int>() == 80);
+
+  ini::IniFile other;
+  other.Decode("[net]\nport=81");
+  inif = other;
+  REQUIRE(handle.As<int>() == 81);
+
+  ini::IniFileBase<ini::StringLess, ini::FlatMapContainer> flat;
+  flat.Decode("[net]\nport=82");
+  const auto flat_handle = flat.Resolve("net", "port");
+  REQUIRE(flat_handle.As<int>() == 82);
+  flat["net"]["a"] = 1;
+  flat.InvalidateHandles();
+  REQUIRE(flat_handle.As<int>() == 82);
+  REQUIRE(flat_handle.Find() == &flat["net"]["port"]);
+}
+
+TEMPLATE_TEST_CASE("resolved handle follows inserts and erases without invalidation", "IniFile",
+                   (ini::IniFileBase<ini::StringLess, ini::MapContainer>),
+                   (ini::IniFileBase<ini::StringLess, ini::FlatMapContainer>),
+                   (ini::IniFileBase<ini::StringLess, ini::HashMapContainer>),
+                   (ini::IniFileBase<ini::StringLess, ini::OrderedMapContainer>)) {
+  TestType inif;
+  inif.Decode("[net]\nport=80");
+  const auto handle = inif.Resolve("net", "port");
+  const auto later = inif.Resolve("net", "field_199");
+  REQUIRE(handle.template As<int>() == 80);
+  REQUIRE_FALSE(later.Exists());
+
+  // enough fields and sections to make the containers move their entries
+  for (int i = 0; i < 200; ++i) {
+    inif["net"]["field_" + std::to_string(i)] = i;
+    REQUIRE(handle.template As<int>() == 80);
+    inif["section_" + std::to_string(i)]["k"] = i;
+    REQUIRE(handle.Find() == &inif["net"]["port"]);
+  }
+  REQUIRE(later.template As<int>() == 199);
+
+  inif["net"].erase("field_199");
+  REQUIRE_FALSE(later.Exists());
+  inif["net"].erase("field_0");
+  REQUIRE(handle.template As<int>() == 80);
+  inif.erase("section_0");
+  REQUIRE(handle.Find() == &inif["net"]["port"]);
+  inif["net"].clear();
+  REQUIRE_FALSE(handle.Exists());
+  inif["net"]["port"] = 81;
+  REQUIRE(handle.template As<int>() == 81);
+  inif.erase("net");
+  REQUIRE_FALSE(handle.Exists());
+}
@@ -0,0 +1,206 @@
+/*
+ * test_lazy.cpp
+ *
+ * Tests for decoding ini files with lazily parsed sections.
+ */
+
+#include "inicpp.h"
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+static const std::string kContent =
+    "# preamble comment\n"
+    "\n"
+    "[Foo]\n"
+    "a = 1 ; comment\n"
+    "b = multi\n"
+    "  line\n"
+    "  [Bar] # indented header\n"
+    "c = \\# not a comment\n"
+    "[Baz]\n"
+    "[Foo]\n"
+    "a = 2\n"
+    "d = 4";
+
+TEST_CASE("lazy decode matches eager decode", "Lazy") {
+  ini::IniFile eager;
+  eager.SetMultiLineValues(true);
+  eager.Decode(kContent);
+
+  ini::IniFile lazy;
+  lazy.SetMultiLineValues(true);
+  lazy.DecodeLazy(kContent);
+
+  REQUIRE(lazy.size() == eager.size());
+  REQUIRE(lazy.Encode() == eager.Encode());
+  REQUIRE(lazy["Foo"]["a"].As<int>() == 2);
+  REQUIRE(lazy["Foo"]["b"].As<std::string>() == "multi\nline");
+  REQUIRE(lazy["Bar"]["c"].As<std::string>() == "# not a comment");
+  REQUIRE(lazy["Baz"].empty());
+}
+
+TEST_CASE("lazy sections are parsed by operator[], at, find and iteration", "Lazy") {
+  ini::IniFile inif;
+  inif.DecodeLazy("[A]\nx=1\n[B]\nx=2\n[C]\nx=3\n[D]\nx=4\n");
+  REQUIRE(inif.size() == 4);
+  REQUIRE(inif.count("C") == 1);
+
+  REQUIRE(inif["A"]["x"].As<int>() == 1);
+  REQUIRE(inif.at("B").at("x").As<int>() == 2);
+  REQUIRE(inif.find("C")->second.at("x").As<int>() == 3);
+
+  const ini::IniFile& const_inif = inif;
+  int sum = 0;
+  for (const auto& section : const_inif)
+    sum += section.second.at("x").As<int>();
+  REQUIRE(sum == 10);
+}
+
+TEST_CASE("lazy decode merges case insensitive section headers", "Lazy") {
+  const std::string content = "[Foo]\na=1\n[Bar]\n[FOO]\nb=2\n";
+  ini::IniFileCaseInsensitive eager;
+  eager.Decode(content);
+  ini::IniFileCaseInsensitive lazy;
+  lazy.DecodeLazy(content);
+
+  REQUIRE(lazy.size() == 2);
+  REQUIRE(lazy["foo"].size() == 2);
+  REQUIRE(lazy.begin()->first == eager.begin()->first);
+  REQUIRE(lazy.Encode() == eager.Encode());
+}
+
+TEST_CASE("lazy decode reports errors of a section on its first access", "Lazy") {
+  ini::IniFile inif;
+  inif.DecodeLazy("[A]\na=1\n[B]\nbroken\n");
+  REQUIRE(inif["A"]["a"].As<int>() == 1);
+  REQUIRE_THROWS_WITH(inif["B"], Catch::Contains("l.4:"));
+}
+
+TEST_CASE("lazy section with errors throws on every access", "Lazy") {
+  ini::IniFile inif;
+  inif.DecodeLazy("[a]\nk=1\nbad line\nz=2\n[b]\nk=2\n");
+  REQUIRE_THROWS_WITH(inif["a"], Catch::Contains("l.3:"));
+  REQUIRE_THROWS_WITH(inif["a"], Catch::Contains("l.3:"));
+  REQUIRE_THROWS_WITH(inif.DecodePending(), Catch::Contains("l.3:"));
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif.erase("a") == 1);
+  inif.DecodePending();
+  REQUIRE(inif["b"]["k"].As<int>() == 2);
+}
+
+TEST_CASE("lazy decode reports duplicate fields across repeated headers", "Lazy") {
+  ini::IniFile inif;
+  inif.AllowOverwriteDuplicateFields(false);
+  inif.DecodeLazy("[A]\na=1\n[B]\n[A]\na=2\n");
+  REQUIRE_THROWS_WITH(inif.find("A"), Catch::Contains("l.5:"));
+}
+
+TEST_CASE("lazy decode reports malformed headers and preamble right away", "Lazy") {
+  ini::IniFile inif;
+  REQUIRE_THROWS_WITH(inif.DecodeLazy("[A]\na=1\n[B\n"), Catch::Contains("l.3:"));
+  REQUIRE_THROWS_WITH(inif.DecodeLazy("a=1\n[A]\n"), Catch::Contains("l.1:"));
+}
+
+TEST_CASE("lazy decode falls back to eager decode if '[' starts comments", "Lazy") {
+  ini::IniFile inif('=', {"[!"});
+  inif.DecodeLazy("[A]\n[! comment\na=1\n");
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif["A"]["a"].As<int>() == 1);
+}
+
+TEST_CASE("lazily loaded file outlives its copies and the file on disk", "Lazy") {
+  const char* file_name = "inicpp_lazy.ini";
+  {
+    std::ofstream os(file_name);
+    os << kContent;
+  }
+  ini::IniFile copy;
+  {
+    ini::IniFile inif;
+    inif.SetMultiLineValues(true);
+    inif.LoadLazy(file_name);
+    copy = inif;
+    REQUIRE(inif["Foo"]["d"].As<int>() == 4);
+  }
+  std::remove(file_name);
+
+  ini::IniFile eager;
+  eager.SetMultiLineValues(true);
+  eager.Decode(kContent);
+  copy.SetMultiLineValues(true);
+  REQUIRE(copy.Encode() == eager.Encode());
+}
+
+TEST_CASE("lazily loaded file survives truncation of the file on disk", "Lazy") {
+  const char* file_name = "inicpp_lazy_truncated.ini";
+  {
+    std::ofstream os(file_name);
+    os << kContent;
+  }
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.LoadLazy(file_name);
+  {
+    std::ofstream os(file_name, std::ios::trunc);
+  }
+
+  ini::IniFile eager;
+  eager.SetMultiLineValues(true);
+  eager.Decode(kContent);
+  REQUIRE(inif.Encode() == eager.Encode());
+  std::remove(file_name);
+}
+
+TEST_CASE("decode discards pending lazy sections", "Lazy") {
+  ini::IniFile inif;
+  inif.DecodeLazy("[A]\na=1\n");
+  inif.Decode("[B]\nb=2\n");
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif.Encode() == "[B]\nb=2\n\n");
+}
+
+TEST_CASE("lazy sections are parsed by comparisons and reverse iteration", "Lazy") {
+  ini::IniFile eager;
+  eager.Decode("[A]\nx=1\n[B]\nx=2\n[C]\nx=3\n");
+
+  ini::IniFile lazy;
+  lazy.DecodeLazy("[A]\nx=1\n[B]\nx=2\n[C]\nx=3\n");
+  REQUIRE(lazy == eager);
+  REQUIRE(eager == lazy);
+
+  ini::IniFile other;
+  other.DecodeLazy("[A]\nx=1\n[B]\nx=5\n[C]\nx=3\n");
+  REQUIRE(other != eager);
+
+  ini::IniFile reversed;
+  reversed.DecodeLazy("[A]\nx=1\n[B]\nx=2\n[C]\nx=3\n");
+  int sum = 0;
+  std::string names;
+  for (auto it = reversed.rbegin(); it != reversed.rend(); ++it) {
+    names += it->first;
+    sum += it->second.at("x").As<int>();
+  }
+  REQUIRE(names == "CBA");
+  REQUIRE(sum == 6);
+
+  ini::IniFile bounded;
+  bounded.DecodeLazy("[A]\nx=1\n[B]\nx=2\n[C]\nx=3\n");
+  REQUIRE(bounded.lower_bound("B")->second.at("x").As<int>() == 2);
+  REQUIRE(std::next(bounded.lower_bound("B"))->second.at("x").As<int>() == 3);
+}
+
+TEST_CASE("erasing lazy sections drops them before they are parsed", "Lazy") {
+  ini::IniFile inif;
+  inif.DecodeLazy("[A]\nx=1\n[B]\nx=2\n[C]\nbroken\n[D]\nx=4\n");
+  REQUIRE(inif.erase("C") == 1);
+  REQUIRE(inif.erase("C") == 0);
+  inif.erase(inif.find("A"));
+  REQUIRE(inif.size() == 2);
+
+  // the erased section is not parsed, so its error is never reported
+  inif["C"]["y"] = 3;
+  REQUIRE(inif.Encode() == "[B]\nx=2\n\n[C]\ny=3\n\n[D]\nx=4\n\n");
+}
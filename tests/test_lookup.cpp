@@ -0,0 +1,81 @@
+/*
+ * test_lookup.cpp
+ *
+ * Tests for looking up sections and fields by C strings and views.
+ */
+
+#include "inicpp.h"
+
+#include "allocation_counter.h"
+
+#include <catch2/catch.hpp>
+#include <stdexcept>
+#include <string>
+
+using FlatIniFile = ini::IniFileBase<ini::StringLess, ini::FlatMapContainer>;
+using FlatIniFileCaseInsensitive = ini::IniFileBase<ini::StringInsensitiveLess, ini::FlatMapContainer>;
+using HashIniFile = ini::IniFileBase<ini::StringLess, ini::HashMapContainer>;
+using HashIniFileCaseInsensitive = ini::IniFileBase<ini::StringInsensitiveLess, ini::HashMapContainer>;
+
+TEMPLATE_TEST_CASE("lookup by C string and view", "Lookup", ini::IniFile, ini::IniFileCaseInsensitive, FlatIniFile,
+                   HashIniFile) {
+  TestType inif;
+  inif.Decode("[a_section_name_longer_than_sso]\na_field_name_longer_than_sso=42");
+  const TestType& const_inif = inif;
+  const ini::StringView section("a_section_name_longer_than_sso");
+  const ini::StringView field("a_field_name_longer_than_sso");
+
+  REQUIRE(inif["a_section_name_longer_than_sso"]["a_field_name_longer_than_sso"].template As<int>() == 42);
+  REQUIRE(inif[section][field].template As<int>() == 42);
+  REQUIRE(const_inif.at(section).at(field).template As<int>() == 42);
+  REQUIRE(inif.find(section) != inif.end());
+  REQUIRE(inif.find("missing") == inif.end());
+  REQUIRE(inif.contains(section));
+  REQUIRE_FALSE(inif.contains("missing"));
+  REQUIRE(inif.at(section).contains(field));
+  REQUIRE_FALSE(inif.at(section).contains("missing"));
+  REQUIRE_THROWS_AS(inif.at("missing"), std::out_of_range);
+  REQUIRE_THROWS_AS(inif.at(section).at("missing"), std::out_of_range);
+
+  inif["new_section"]["new_field"] = 1;
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif[std::string("new_section")]["new_field"].template As<int>() == 1);
+}
+
+TEST_CASE("case insensitive lookup by view ignores case", "Lookup") {
+  ini::IniFileCaseInsensitive inif;
+  inif.Decode("[Foo]\nBar=1");
+
+  REQUIRE(inif.contains(ini::StringView("FOO")));
+  REQUIRE(inif.at("foo").at("BAR").As<int>() == 1);
+}
+
+template <typename File>
+static std::size_t CountLookupAllocations(File& inif) {
+  const File& const_inif = inif;
+  const ini::StringView section("a_section_name_longer_than_sso");
+  int sum = 0;
+  std::size_t count;
+  // before C++14 the first lookups of std::map grow a per-thread key
+  sum += inif.at(section).at("a_field_name_longer_than_sso").template As<int>();
+  {
+    AllocationCounter counter;
+    sum += inif["a_section_name_longer_than_sso"]["a_field_name_longer_than_sso"].template As<int>();
+    sum += inif[section]["a_field_name_longer_than_sso"].template As<int>();
+    sum += const_inif.at(section).at("a_field_name_longer_than_sso").template As<int>();
+    sum += inif.find("a_section_name_longer_than_sso")->second.contains("a_field_name_longer_than_sso") ? 1 : 0;
+    sum += inif.contains("a_section_name_longer_than_sso") ? 1 : 0;
+    count = counter.Count();
+  }
+  REQUIRE(sum == 4 * 42 + 2);
+  return count;
+}
+
+TEMPLATE_TEST_CASE("lookup by C string and view does not allocate", "Lookup", ini::IniFile,
+                   ini::IniFileCaseInsensitive, FlatIniFile, FlatIniFileCaseInsensitive, HashIniFile,
+                   HashIniFileCaseInsensitive) {
+  TestType inif;
+  inif.Decode("[a_section_name_longer_than_sso]\na_field_name_longer_than_sso=42");
+
+  REQUIRE(CountLookupAllocations(inif) == 0);
+}
@@ -0,0 +1,128 @@
+/*
+ * test_parallel.cpp
+ *
+ * Tests for decoding ini files on several threads.
+ */
+
+#include "inicpp.h"
+
+#include <cstdio>
+
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <string>
+
+static std::string MakeContent(const int sections, const int fields) {
+  std::string content = "# generated\n";
+  for (int sec = 0; sec < sections; ++sec) {
+    content += "[Section" + std::to_string(sec % (sections / 2 + 1)) + "]\n";
+    for (int field = 0; field < fields; ++field)
+      content += "key" + std::to_string(field) + " = " + std::to_string(sec * field) + " ; comment\n";
+  }
+  return content;
+}
+
+static void RequireSameContent(const ini::IniFile& lhs, const ini::IniFile& rhs) {
+  REQUIRE(lhs.size() == rhs.size());
+  REQUIRE(lhs.Encode() == rhs.Encode());
+}
+
+TEST_CASE("parallel decode matches sequential decode", "Parallel") {
+  const std::string content = MakeContent(200, 20);
+
+  ini::IniFile sequential;
+  sequential.Decode(content);
+
+  for (unsigned threads = 1; threads <= 8; ++threads) {
+    ini::IniFile parallel;
+    parallel.DecodeParallel(content, threads);
+    RequireSameContent(sequential, parallel);
+  }
+}
+
+TEST_CASE("parallel decode lets later sections and fields win", "Parallel") {
+  std::string content = "[A]\nx=1\ny=1\n";
+  for (int i = 0; i < 100; ++i)
+    content += "[Filler" + std::to_string(i) + "]\nk=v\n";
+  content += "[A]\nx=2\nz=2\n";
+
+  ini::IniFile inif;
+  inif.DecodeParallel(content, 4);
+  REQUIRE(inif["A"]["x"].As<int>() == 2);
+  REQUIRE(inif["A"]["y"].As<int>() == 1);
+  REQUIRE(inif["A"]["z"].As<int>() == 2);
+  REQUIRE(inif.size() == 101);
+}
+
+TEST_CASE("parallel decode keeps multi-line values", "Parallel") {
+  std::string content;
+  for (int i = 0; i < 50; ++i)
+    content += "[S" + std::to_string(i) + "]\nv = first\n  second\n  third\n";
+
+  ini::IniFile sequential;
+  sequential.SetMultiLineValues(true);
+  sequential.Decode(content);
+
+  ini::IniFile parallel;
+  parallel.SetMultiLineValues(true);
+  parallel.DecodeParallel(content, 4);
+  RequireSameContent(sequential, parallel);
+  REQUIRE(parallel["S42"]["v"].As<std::string>() == "first\nsecond\nthird");
+}
+
+TEST_CASE("parallel decode reports errors with their line number", "Parallel") {
+  std::string content;
+  for (int i = 0; i < 100; ++i)
+    content += "[S" + std::to_string(i) + "]\nk=v\n";
+  // line 201
+  content += "[S100]\nbroken line\n";
+
+  ini::IniFile inif;
+  REQUIRE_THROWS_WITH(inif.DecodeParallel(content, 4), Catch::Contains("l.202:"));
+}
+
+TEST_CASE("parallel decode detects duplicate fields across parts", "Parallel") {
+  std::string content = "[A]\nx=1\n";
+  for (int i = 0; i < 100; ++i)
+    content += "[Filler" + std::to_string(i) + "]\nk=v\n";
+  content += "[A]\nx=2\n";
+
+  ini::IniFile inif;
+  inif.AllowOverwriteDuplicateFields(false);
+  REQUIRE_THROWS_WITH(inif.DecodeParallel(content, 4), Catch::Contains("l.204:"));
+}
+
+TEST_CASE("parallel decode does not split at comments starting with '['", "Parallel") {
+  std::string content;
+  for (int i = 0; i < 50; ++i)
+    content += "[S" + std::to_string(i) + "]\nv = first\n[ comment\n  second\n";
+
+  ini::IniFile sequential;
+  sequential.SetCommentPrefixes({"#", "[ "});
+  sequential.SetMultiLineValues(true);
+  sequential.Decode(content);
+
+  ini::IniFile parallel;
+  parallel.SetCommentPrefixes({"#", "[ "});
+  parallel.SetMultiLineValues(true);
+  parallel.DecodeParallel(content, 4);
+  RequireSameContent(sequential, parallel);
+  REQUIRE(parallel["S7"]["v"].As<std::string>() == "first\nsecond");
+}
+
+TEST_CASE("parallel load from file", "Parallel") {
+  const char* file_name = "test_parallel_tmp.ini";
+  const std::string content = MakeContent(100, 10);
+  {
+    std::ofstream os(file_name);
+    os << content;
+  }
+
+  ini::IniFile sequential;
+  sequential.Decode(content);
+  ini::IniFile parallel;
+  parallel.LoadParallel(file_name, 3);
+  RequireSameContent(sequential, parallel);
+
+  std::remove(file_name);
+}
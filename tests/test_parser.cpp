@@ -0,0 +1,316 @@
+/*
+ * test_parser.cpp
+ *
+ * Tests for the event based IniParser.
+ */
+
+#include "inicpp.h"
+
+#include "allocation_counter.h"
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/** Records all events as strings. */
+struct RecordingHandler : public ini::IniHandler {
+  std::vector<std::string> events;
+  bool skip_errors = false;
+
+  bool OnSection(int line, ini::StringView name) {
+    events.push_back(std::to_string(line) + " section " + std::string(name));
+    return true;
+  }
+
+  bool OnField(int line, ini::StringView name, ini::StringView value) {
+    events.push_back(std::to_string(line) + " field " + std::string(name) + "=" + std::string(value));
+    return true;
+  }
+
+  bool OnContinuation(int line, ini::StringView value) {
+    events.push_back(std::to_string(line) + " continuation " + std::string(value));
+    return true;
+  }
+
+  bool OnComment(int line, ini::StringView text) {
+    events.push_back(std::to_string(line) + " comment " + std::string(text));
+    return true;
+  }
+
+  bool OnError(const ini::ParseError& error) {
+    events.push_back(std::to_string(error.line) + " error " + ini::ErrorMessage(error.code));
+    return skip_errors;
+  }
+};
+
+TEST_CASE("parser reports sections, fields and comments in order", "IniParser") {
+  ini::IniParser parser;
+  RecordingHandler handler;
+  REQUIRE(parser.Parse("# head\n[Foo]\n  a = 1 ; one\nb=\\;2\n\n[Bar]\nc=3", handler));
+
+  std::vector<std::string> expected = {"1 comment # head", "2 section Foo", "3 field a=1",
+                                       "3 comment ; one",  "4 field b=;2",  "6 section Bar",
+                                       "7 field c=3"};
+  REQUIRE(handler.events == expected);
+}
+
+TEST_CASE("parser reports continuations of multi-line values", "IniParser") {
+  ini::IniParser parser;
+  parser.SetMultiLineValues(true);
+  RecordingHandler handler;
+  REQUIRE(parser.Parse("[Foo]\na = 1\n  2\n\t3\n[Bar]\n", handler));
+
+  std::vector<std::string> expected = {"1 section Foo", "2 field a=1", "3 continuation 2", "4 continuation 3",
+                                       "5 section Bar"};
+  REQUIRE(handler.events == expected);
+}
+
+TEST_CASE("parser stops at the first error by default", "IniParser") {
+  ini::IniParser parser;
+  RecordingHandler handler;
+  REQUIRE_FALSE(parser.Parse("[Foo]\na=1\nbroken\nb=2\n", handler));
+
+  std::vector<std::string> expected = {"1 section Foo", "2 field a=1", "3 error no field separator found"};
+  REQUIRE(handler.events == expected);
+}
+
+TEST_CASE("parser skips bad lines if the handler continues", "IniParser") {
+  ini::IniParser parser;
+  RecordingHandler handler;
+  handler.skip_errors = true;
+  REQUIRE(parser.Parse("orphan=1\n[Foo]\nbroken\na=1\n[Bar\nb=2\n[]\nc=3\n[Baz]\nd=4\n", handler));
+
+  std::vector<std::string> expected = {"1 error field has no section",
+                                       "2 section Foo",
+                                       "3 error no field separator found",
+                                       "4 field a=1",
+                                       "5 error section not closed",
+                                       "7 error section is empty",
+                                       "9 section Baz",
+                                       "10 field d=4"};
+  REQUIRE(handler.events == expected);
+}
+
+TEST_CASE("parser uses custom separator and comment prefixes", "IniParser") {
+  ini::IniParser parser(':', {"//"});
+  RecordingHandler handler;
+  REQUIRE(parser.Parse("[Foo]\na: x # y // z\n", handler));
+
+  std::vector<std::string> expected = {"1 section Foo", "2 field a=x # y", "2 comment // z"};
+  REQUIRE(handler.events == expected);
+}
+
+TEST_CASE("decode uses the parser settings of the file", "IniParser") {
+  ini::IniFile inif(':', {"//"});
+  inif.SetMultiLineValues(true);
+  REQUIRE(inif.Parser().FieldSep() == ':');
+  REQUIRE(inif.Parser().MultiLineValues());
+
+  inif.Decode("[Foo]\na: 1 // c\n  2\n");
+  REQUIRE(inif["Foo"]["a"].As<std::string>() == "1\n2");
+}
+
+/** Writes a file of the given number of sections with multi-line values. */
+static std::string WriteSections(const char* file_name, const int sections) {
+  std::string content;
+  for (int sec = 0; sec < sections; ++sec) {
+    content += "[Section" + std::to_string(sec) + "]\n";
+    for (int field = 0; field < 20; ++field)
+      content += "key" + std::to_string(field) + " = value ; comment\n  continued\n";
+  }
+  std::ofstream os(file_name, std::ios::binary);
+  os << content;
+  return content;
+}
+
+/** Counts sections without allocating. */
+struct SectionCounter : public ini::IniHandler {
+  int sections = 0;
+
+  bool OnSection(int /* line */, ini::StringView /* name */) {
+    ++sections;
+    return true;
+  }
+};
+
+TEST_CASE("parse file reports the same events as parse", "IniParser") {
+  const char* file_name = "inicpp_parse_file.ini";
+  // several read chunks, so lines and values span chunk boundaries
+  const std::string content = WriteSections(file_name, 500);
+  ini::IniParser parser;
+  parser.SetMultiLineValues(true);
+  RecordingHandler expected;
+  REQUIRE(parser.Parse(content, expected));
+  RecordingHandler handler;
+  REQUIRE(parser.ParseFile(file_name, handler));
+  REQUIRE(handler.events == expected.events);
+  std::remove(file_name);
+
+  RecordingHandler missing;
+  REQUIRE(parser.ParseFile("inicpp_parse_file_missing.ini", missing));
+  REQUIRE(missing.events.empty());
+}
+
+TEST_CASE("parse file allocates independently of the file size", "IniParser") {
+  const char* file_name = "inicpp_parse_file.ini";
+  ini::IniParser parser;
+  parser.SetMultiLineValues(true);
+  std::size_t bytes[2];
+  const int sections[2] = {100, 5000};
+  for (int i = 0; i < 2; ++i) {
+    WriteSections(file_name, sections[i]);
+    SectionCounter handler;
+    AllocationCounter counter;
+    REQUIRE(parser.ParseFile(file_name, handler));
+    bytes[i] = counter.Bytes();
+    REQUIRE(handler.sections == sections[i]);
+  }
+  std::remove(file_name);
+  // all requested bytes bound the peak, the larger file is about 3.5 MiB;
+  // only the buffer of a line that spans two chunks grows with the line
+  REQUIRE(bytes[0] < 1024);
+  REQUIRE(bytes[1] < 1024);
+}
+
+TEST_CASE("feed parser handles lines split at every position", "IniFeedParser") {
+  const std::string content = "[Foo]\na = 1 ; one\nb=x\\;y\n  cont\n\n[Bar]\r\nc=3";
+  ini::IniParser parser;
+  parser.SetMultiLineValues(true);
+  RecordingHandler expected;
+  REQUIRE(parser.Parse(content, expected));
+
+  for (std::size_t split = 0; split <= content.size(); ++split) {
+    RecordingHandler handler;
+    ini::IniFeedParser<RecordingHandler> feed(parser, handler);
+    REQUIRE(feed.Feed(content.data(), split));
+    REQUIRE(feed.Feed(content.data() + split, content.size() - split));
+    REQUIRE(feed.Finish());
+    REQUIRE(handler.events == expected.events);
+  }
+}
+
+TEST_CASE("feed parser handles single character chunks", "IniFeedParser") {
+  const std::string content = "[Foo]\na = 1\n  2\nb = \\#3 # c\n";
+  ini::IniParser parser;
+  parser.SetMultiLineValues(true);
+  RecordingHandler expected;
+  REQUIRE(parser.Parse(content, expected));
+
+  RecordingHandler handler;
+  ini::IniFeedParser<RecordingHandler> feed(parser, handler);
+  for (const char c : content)
+    REQUIRE(feed.Feed(&c, 1));
+  REQUIRE(feed.Finish());
+  REQUIRE(handler.events == expected.events);
+}
+
+TEST_CASE("feed parser stops when the handler stops", "IniFeedParser") {
+  ini::IniParser parser;
+  RecordingHandler handler;
+  ini::IniFeedParser<RecordingHandler> feed(parser, handler);
+  REQUIRE(feed.Feed("[Foo]\nbro", 9));
+  REQUIRE_FALSE(feed.Feed("ken\na=1\n", 8));
+  REQUIRE_FALSE(feed.Feed("b=2\n", 4));
+  REQUIRE_FALSE(feed.Finish());
+
+  std::vector<std::string> expected = {"1 section Foo", "2 error no field separator found"};
+  REQUIRE(handler.events == expected);
+}
+
+TEST_CASE("decoder fills the file from chunks", "IniFeedParser") {
+  const std::string content = "[Foo]\nname = multi\n  line\nvalue=\\;x ; comment\n[Bar]\nkey=1";
+  ini::IniFile expected;
+  expected.SetMultiLineValues(true);
+  expected.Decode(content);
+
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif["Old"]["x"] = 1;
+  ini::IniFile::Decoder decoder(inif);
+  for (std::size_t pos = 0; pos < content.size(); pos += 7)
+    decoder.Feed(content.data() + pos, std::min<std::size_t>(7, content.size() - pos));
+  decoder.Finish();
+
+  REQUIRE(inif.Encode() == expected.Encode());
+  REQUIRE(inif["Foo"]["name"].As<std::string>() == "multi\nline");
+  REQUIRE(inif["Foo"]["value"].As<std::string>() == ";x");
+  REQUIRE(inif.count("Old") == 0);
+}
+
+TEST_CASE("decoder throws with the line number of the bad line", "IniFeedParser") {
+  ini::IniFile inif;
+  ini::IniFile::Decoder decoder(inif);
+  decoder.Feed("[Foo]\na=1\n", 10);
+  REQUIRE_THROWS_WITH(decoder.Feed("broken\n", 7), Catch::Contains("l.3:"));
+}
+
+TEST_CASE("decoder can be neither copied nor moved", "IniFeedParser") {
+  STATIC_REQUIRE_FALSE(std::is_copy_constructible<ini::IniFile::Decoder>::value);
+  STATIC_REQUIRE_FALSE(std::is_move_constructible<ini::IniFile::Decoder>::value);
+  STATIC_REQUIRE_FALSE(std::is_copy_assignable<ini::IniFile::Decoder>::value);
+  STATIC_REQUIRE_FALSE(std::is_move_assignable<ini::IniFile::Decoder>::value);
+}
+
+TEST_CASE("try decode reports no errors for valid input", "TryDecode") {
+  ini::IniFile inif;
+  const ini::DecodeResult result = inif.TryDecode("[Foo]\na=1\n");
+  REQUIRE(result.Ok());
+  REQUIRE(static_cast<bool>(result));
+  REQUIRE(inif["Foo"]["a"].As<int>() == 1);
+}
+
+TEST_CASE("try decode stops at the first error", "TryDecode") {
+  ini::IniFile inif;
+  const ini::DecodeResult result = inif.TryDecode("[Foo]\na=1\n  broken\nb=2\n");
+  REQUIRE_FALSE(result.Ok());
+  REQUIRE(result.errors.size() == 1);
+  REQUIRE(result.errors[0].line == 3);
+  REQUIRE(result.errors[0].column == 3);
+  REQUIRE(result.errors[0].code == ini::ParseErrorCode::kMissingFieldSep);
+  REQUIRE(inif["Foo"].size() == 1);
+}
+
+TEST_CASE("try decode skips bad lines", "TryDecode") {
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.AllowOverwriteDuplicateFields(false);
+  const std::string content = "a=0\n[Foo]\na=1\nbroken\n\ta=2\n  more\nb=3\n [Bar\nc=4\n[Baz]\nd=5\n";
+  const ini::DecodeResult result = inif.TryDecode(content, ini::ErrorRecovery::kSkipBadLines);
+
+  REQUIRE(result.errors.size() == 4);
+  REQUIRE(result.errors[0].line == 1);
+  REQUIRE(result.errors[0].code == ini::ParseErrorCode::kFieldWithoutSection);
+  REQUIRE(result.errors[1].line == 4);
+  REQUIRE(result.errors[1].code == ini::ParseErrorCode::kMissingFieldSep);
+  REQUIRE(result.errors[2].line == 5);
+  REQUIRE(result.errors[2].code == ini::ParseErrorCode::kDuplicateField);
+  REQUIRE(result.errors[2].column == 2);
+  REQUIRE(result.errors[3].line == 8);
+  REQUIRE(result.errors[3].column == 2);
+  REQUIRE(result.errors[3].code == ini::ParseErrorCode::kSectionNotClosed);
+
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif["Foo"]["a"].As<std::string>() == "1");
+  REQUIRE(inif["Foo"]["b"].As<int>() == 3);
+  REQUIRE(inif["Baz"]["d"].As<int>() == 5);
+}
+
+TEST_CASE("try load reports errors of a file", "TryDecode") {
+  const char* file_name = "inicpp_try_load.ini";
+  {
+    std::ofstream os(file_name);
+    os << "[Foo]\n[]\n";
+  }
+  ini::IniFile inif;
+  const ini::DecodeResult result = inif.TryLoad(file_name);
+  std::remove(file_name);
+
+  REQUIRE(result.errors.size() == 1);
+  REQUIRE(result.errors[0].line == 2);
+  REQUIRE(result.errors[0].code == ini::ParseErrorCode::kSectionEmpty);
+  REQUIRE(std::string(ini::ErrorMessage(result.errors[0].code)) == "section is empty");
+}
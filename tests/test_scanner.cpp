@@ -0,0 +1,160 @@
+/*
+ * test_scanner.cpp
+ *
+ * Tests for ini::LineScanner and ini::CommentPrefixMatcher.
+ */
+
+#include "inicpp.h"
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* FindFirst(const ini::StringView line, const char c) {
+  for (const char* p = line.data(); p != line.data() + line.size(); ++p)
+    if (*p == c)
+      return p;
+  return nullptr;
+}
+
+static void RequireScansLikeReference(const std::string& content, const std::vector<std::string>& prefixes,
+                                      const bool allow_simd) {
+  ini::LineScanner scanner('=', prefixes, allow_simd);
+  ini::LineTokens tokens;
+  const char* pos = content.data();
+  const char* end = content.data() + content.size();
+  std::size_t lines = 0;
+  for (bool last_line = false; !last_line; ++lines) {
+    last_line = !scanner.ScanLine(pos, end, tokens);
+    const char* eol = FindFirst(ini::StringView(pos, static_cast<std::size_t>(end - pos)), '\n');
+    REQUIRE(tokens.line.data() == pos);
+    REQUIRE(tokens.line.end() == (eol == nullptr ? end : eol));
+    REQUIRE(last_line == (eol == nullptr));
+
+    const char* comment = nullptr;
+    for (const std::string& prefix : prefixes) {
+      const char* found = FindFirst(tokens.line, prefix[0]);
+      if (found != nullptr && (comment == nullptr || found < comment))
+        comment = found;
+    }
+    REQUIRE(tokens.comment == comment);
+    REQUIRE(tokens.field_sep == FindFirst(tokens.line, '='));
+    REQUIRE(tokens.section_end == FindFirst(tokens.line, ']'));
+    pos = tokens.line.end() + (last_line ? 0 : 1);
+  }
+  REQUIRE(lines == static_cast<std::size_t>(std::count(content.begin(), content.end(), '\n')) + 1);
+}
+
+TEST_CASE("scanner splits lines and locates tokens", "LineScanner") {
+  const std::string content = "[Section]\nkey = value # comment\n\n  indented=1;2\nno newline at end";
+  ini::LineScanner scanner('=', {"#", ";"});
+  ini::LineTokens tokens;
+
+  REQUIRE(scanner.ScanLine(content.data(), content.data() + content.size(), tokens));
+  REQUIRE(std::string(tokens.line) == "[Section]");
+  REQUIRE(tokens.section_end == tokens.line.data() + 8);
+  REQUIRE(tokens.field_sep == nullptr);
+  REQUIRE(tokens.comment == nullptr);
+
+  const char* pos = tokens.line.end() + 1;
+  REQUIRE(scanner.ScanLine(pos, content.data() + content.size(), tokens));
+  REQUIRE(std::string(tokens.line) == "key = value # comment");
+  REQUIRE(tokens.field_sep == pos + 4);
+  REQUIRE(tokens.comment == pos + 12);
+}
+
+TEST_CASE("scanner reports the last line without newline", "LineScanner") {
+  const std::string content = "a=b";
+  ini::LineScanner scanner('=', {"#"});
+  ini::LineTokens tokens;
+
+  REQUIRE_FALSE(scanner.ScanLine(content.data(), content.data() + content.size(), tokens));
+  REQUIRE(std::string(tokens.line) == "a=b");
+}
+
+TEST_CASE("scanner treats every line as comment for an empty prefix", "LineScanner") {
+  const std::string content = "a=b";
+  ini::LineScanner scanner('=', {""});
+  ini::LineTokens tokens;
+
+  scanner.ScanLine(content.data(), content.data() + content.size(), tokens);
+  REQUIRE(tokens.comment == content.data());
+}
+
+TEST_CASE("simd and scalar scanner agree on random input", "LineScanner") {
+  std::mt19937 rng(42);
+  const char alphabet[] = "ab =#;]\n[\\ \t";
+  std::uniform_int_distribution<std::size_t> pick(0, sizeof(alphabet) - 2);
+  std::uniform_int_distribution<std::size_t> length(0, 300);
+
+  for (int round = 0; round < 200; ++round) {
+    std::string content;
+    const std::size_t size = length(rng);
+    for (std::size_t i = 0; i < size; ++i)
+      content += alphabet[pick(rng)];
+
+    RequireScansLikeReference(content, {"#", ";"}, true);
+    RequireScansLikeReference(content, {"#", ";"}, false);
+  }
+}
+
+TEST_CASE("scanner falls back when there are many comment prefixes", "LineScanner") {
+  std::vector<std::string> prefixes;
+  for (char c = 'a'; c <= 'l'; ++c)
+    prefixes.push_back(std::string(1, c));
+
+  std::string content;
+  for (int i = 0; i < 50; ++i)
+    content += "0123456789=" + std::string(1, static_cast<char>('a' + i % 12)) + "\n";
+
+  RequireScansLikeReference(content, prefixes, true);
+}
+
+TEST_CASE("matcher returns the first listed matching prefix", "CommentPrefixMatcher") {
+  const std::string text = "//x";
+  const char* end = text.data() + text.size();
+
+  ini::CommentPrefixMatcher short_first({"/", "//"});
+  REQUIRE(short_first.Match(text.data(), end) == 1);
+
+  ini::CommentPrefixMatcher long_first({"//", "/"});
+  REQUIRE(long_first.Match(text.data(), end) == 2);
+  REQUIRE(long_first.Match(text.data() + 1, end) == 1);
+  REQUIRE(long_first.Match(text.data() + 2, end) == std::string::npos);
+  REQUIRE(long_first.Match(end, end) == std::string::npos);
+}
+
+TEST_CASE("matcher does not match a prefix cut off by the end", "CommentPrefixMatcher") {
+  const std::string text = "-";
+  ini::CommentPrefixMatcher matcher({"--"});
+
+  REQUIRE(matcher.MayStart('-'));
+  REQUIRE_FALSE(matcher.MayStart('x'));
+  REQUIRE(matcher.Match(text.data(), text.data() + text.size()) == std::string::npos);
+}
+
+TEST_CASE("matcher with an empty prefix matches everywhere", "CommentPrefixMatcher") {
+  const std::string text = "abc";
+  ini::CommentPrefixMatcher matcher({"#", ""});
+
+  REQUIRE(matcher.MayStart('a'));
+  REQUIRE(matcher.Match(text.data(), text.data() + text.size()) == 0);
+}
+
+TEST_CASE("many comment prefixes are escaped and stripped", "CommentPrefixMatcher") {
+  const std::vector<std::string> prefixes = {"#", ";", "//", "--", "rem ", "%%", "!"};
+
+  ini::IniFile out;
+  out.SetCommentPrefixes(prefixes);
+  out["Sec"]["key"] = "a#b;c//d--e rem f%%g!h";
+  const std::string encoded = out.Encode();
+  REQUIRE(encoded == "[Sec]\nkey=a\\#b\\;c\\//d\\--e \\rem f\\%%g\\!h\n\n");
+
+  ini::IniFile in;
+  in.SetCommentPrefixes(prefixes);
+  in.Decode(encoded + "other=1 -- comment\n");
+  REQUIRE(in["Sec"]["key"].As<std::string>() == "a#b;c//d--e rem f%%g!h");
+  REQUIRE(in["Sec"]["other"].As<int>() == 1);
+}
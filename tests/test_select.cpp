@@ -0,0 +1,144 @@
+/*
+ * test_select.cpp
+ *
+ * Tests for decoding only selected sections of ini files.
+ */
+
+#include "inicpp.h"
+
+#include "allocation_counter.h"
+
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const std::string kContent =
+    "[global]\n"
+    "threads = 4\n"
+    "[worker.1]\n"
+    "port = 8001\n"
+    "  broken line\n"
+    "\tindented [not a header]\n"
+    "[worker.2]\n"
+    "port = 8002\n"
+    "name = multi\n"
+    "  line\n"
+    "  [worker.1] # indented header\n"
+    "user = one\n"
+    "[worker.3]\n"
+    "port = 8003";
+
+TEST_CASE("decode selects sections by name", "Select") {
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode(kContent, std::vector<std::string>{"global", "worker.2"});
+
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif["global"]["threads"].As<int>() == 4);
+  REQUIRE(inif["worker.2"]["port"].As<int>() == 8002);
+  REQUIRE(inif["worker.2"]["name"].As<std::string>() == "multi\nline");
+}
+
+TEST_CASE("decode selects sections by predicate", "Select") {
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode(kContent, [](ini::StringView name) { return name == ini::StringView("worker.1"); });
+
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif["worker.1"].size() == 2);
+  REQUIRE(inif["worker.1"]["port"].As<std::string>() == "8001\nbroken line\nindented [not a header]");
+  REQUIRE(inif["worker.1"]["user"].As<std::string>() == "one");
+}
+
+TEST_CASE("selected sections match a full decode", "Select") {
+  ini::IniFile full;
+  full.SetMultiLineValues(true);
+  full.Decode(kContent + "\n[worker.2]\nport = 9002\n");
+
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Decode(kContent + "\n[worker.2]\nport = 9002\n", std::vector<std::string>{"worker.2", "worker.3"});
+
+  REQUIRE(inif.size() == 2);
+  REQUIRE(inif["worker.2"].size() == full["worker.2"].size());
+  REQUIRE(inif["worker.2"]["port"].As<int>() == 9002);
+  REQUIRE(inif["worker.3"]["port"].As<int>() == 8003);
+}
+
+TEST_CASE("decode reports errors with correct lines after skipped sections", "Select") {
+  ini::IniFile inif;
+  REQUIRE_THROWS_WITH(inif.Decode("[a]\nx=1\n\ny\n[b]\nbroken\n", std::vector<std::string>{"b"}),
+                      Catch::Contains("l.6:"));
+}
+
+TEST_CASE("selection uses the comparator of the file", "Select") {
+  ini::IniFileCaseInsensitive inif;
+  inif.Decode("[Foo]\na=1\n[Bar]\nb=2\n", std::vector<std::string>{"FOO"});
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif["foo"]["a"].As<int>() == 1);
+}
+
+/** Counts the allocations of decoding the selected section of a file with
+ * the given number of other sections. */
+static std::size_t CountSelectAllocations(const int skipped) {
+  std::string content = "[selected_section_with_a_long_name]\nk=v\n";
+  for (int i = 0; i < skipped; ++i)
+    content += "[skipped_section_with_a_long_name_" + std::to_string(i) + "]\nk=v\n";
+  const std::vector<std::string> sections(1, "selected_section_with_a_long_name");
+
+  ini::IniFile inif;
+  // warms up the key that std::map uses before C++14
+  inif.Decode(content, sections);
+  AllocationCounter counter;
+  inif.Decode(content, sections);
+  return counter.Count();
+}
+
+TEST_CASE("selection does not allocate for skipped sections", "Select") {
+  REQUIRE(CountSelectAllocations(100) == CountSelectAllocations(1));
+}
+
+TEST_CASE("selection works if '[' starts comments", "Select") {
+  ini::IniFile inif('=', {"[!"});
+  inif.Decode("[a]\n[! comment\nx=1\n[b]\ny=2\n", std::vector<std::string>{"b"});
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif["b"]["y"].As<int>() == 2);
+}
+
+TEST_CASE("load selects sections of a file", "Select") {
+  const char* file_name = "inicpp_select.ini";
+  {
+    std::ofstream os(file_name);
+    os << kContent;
+  }
+  ini::IniFile inif;
+  inif.SetMultiLineValues(true);
+  inif.Load(file_name, std::vector<std::string>{"worker.3"});
+  std::remove(file_name);
+
+  REQUIRE(inif.size() == 1);
+  REQUIRE(inif["worker.3"]["port"].As<int>() == 8003);
+}
+
+TEST_CASE("feed parser skips sections across chunks", "Select") {
+  struct Handler : public ini::IniHandler {
+    std::vector<std::string> fields;
+    bool SelectSection(int, ini::StringView name) { return name != ini::StringView("skip"); }
+    bool OnField(int line, ini::StringView name, ini::StringView) {
+      fields.push_back(std::to_string(line) + ":" + std::string(name));
+      return true;
+    }
+  };
+  const std::string content = "[skip]\na=1\n  [ keep ]\nb=2\n[skip]\nc=3\n[other]\nd=4";
+  ini::IniParser parser;
+  for (std::size_t split = 0; split <= content.size(); ++split) {
+    Handler handler;
+    ini::IniFeedParser<Handler> feed(parser, handler);
+    REQUIRE(feed.Feed(content.data(), split));
+    REQUIRE(feed.Feed(content.data() + split, content.size() - split));
+    REQUIRE(feed.Finish());
+    REQUIRE(handler.fields == std::vector<std::string>{"4:b", "8:d"});
+  }
+}
@@ -0,0 +1,149 @@
+/*
+ * test_watcher.cpp
+ *
+ * Tests for watching ini files for changes.
+ */
+
+#include "inicpp.h"
+
+#ifdef INICPP_HAS_INOTIFY
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+static void WriteFile(const std::string& file_name, const std::string& content) {
+  std::ofstream os(file_name.c_str());
+  os << content;
+}
+
+static const std::chrono::milliseconds kTimeout(5000);
+
+TEST_CASE("watcher publishes the initial file", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na=1\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(), std::chrono::milliseconds(10));
+  REQUIRE(watcher.Version() == 1);
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 1);
+  std::remove(file_name.c_str());
+}
+
+TEST_CASE("watcher picks up writes in place and atomic renames", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na=1\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(), std::chrono::milliseconds(10));
+  const std::shared_ptr<const ini::IniFile> first = watcher.Current();
+
+  WriteFile(file_name, "[Foo]\na=2\n");
+  REQUIRE(watcher.WaitForVersion(2, kTimeout));
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 2);
+
+  WriteFile(file_name + ".tmp", "[Foo]\na=3\n");
+  REQUIRE(std::rename((file_name + ".tmp").c_str(), file_name.c_str()) == 0);
+  REQUIRE(watcher.WaitForVersion(3, kTimeout));
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 3);
+
+  // readers keep the file they hold
+  REQUIRE(first->at("Foo").at("a").As<int>() == 1);
+  std::remove(file_name.c_str());
+}
+
+TEST_CASE("watcher keeps the last good file on errors", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na=1\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(), std::chrono::milliseconds(10));
+
+  WriteFile(file_name, "[Foo]\nbroken\n");
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (watcher.LastResult().Ok() && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  REQUIRE_FALSE(watcher.LastResult().Ok());
+  REQUIRE(watcher.LastResult().errors[0].line == 2);
+  REQUIRE(watcher.Version() == 1);
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 1);
+
+  WriteFile(file_name, "[Foo]\na=4\n");
+  REQUIRE(watcher.WaitForVersion(2, kTimeout));
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 4);
+  std::remove(file_name.c_str());
+}
+
+TEST_CASE("watcher clears the error when the published contents come back", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na=1\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(), std::chrono::milliseconds(10));
+
+  WriteFile(file_name, "[Foo]\nbroken\n");
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (watcher.LastResult().Ok() && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  REQUIRE_FALSE(watcher.LastResult().Ok());
+
+  WriteFile(file_name, "[Foo]\na=1\n");
+  deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (!watcher.LastResult().Ok() && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  REQUIRE(watcher.LastResult().Ok());
+  REQUIRE(watcher.Version() == 1);
+  REQUIRE(watcher.WatchError() == 0);
+  std::remove(file_name.c_str());
+}
+
+TEST_CASE("watcher debounces bursts of writes", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na=0\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(), std::chrono::milliseconds(200));
+  for (int i = 1; i <= 10; ++i)
+    WriteFile(file_name, "[Foo]\na=" + std::to_string(i) + "\n");
+  REQUIRE(watcher.WaitForVersion(2, kTimeout));
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  REQUIRE(watcher.Version() == 2);
+  std::remove(file_name.c_str());
+}
+
+TEST_CASE("watcher uses the settings of the prototype", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na:1\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(':', {"#"}), std::chrono::milliseconds(10));
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 1);
+  std::remove(file_name.c_str());
+}
+
+TEST_CASE("watcher survives a file truncated while it is read", "IniWatcher") {
+  const std::string file_name = "inicpp_watch.ini";
+  WriteFile(file_name, "[Foo]\na=1\n");
+  ini::IniWatcher watcher(file_name, ini::IniFile(), std::chrono::milliseconds(0));
+
+  // truncates and rewrites the file with comments, so every prefix decodes
+  std::atomic<bool> stop(false);
+  std::thread writer([&file_name, &stop]() {
+    const std::string chunk(65536, '#');
+    while (!stop.load()) {
+      std::ofstream os(file_name.c_str(), std::ios::binary | std::ios::trunc);
+      for (int i = 0; i < 32 && !stop.load(); ++i) {
+        os << chunk << '\n';
+        os.flush();
+      }
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  stop.store(true);
+  writer.join();
+  REQUIRE(watcher.Version() > 1);
+
+  const std::uint64_t version = watcher.Version();
+  WriteFile(file_name, "[Foo]\na=2\n");
+  REQUIRE(watcher.WaitForVersion(version + 1, kTimeout));
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (watcher.Current()->count("Foo") == 0 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  REQUIRE(watcher.Current()->at("Foo").at("a").As<int>() == 2);
+  std::remove(file_name.c_str());
+}
+
+#endif